@@ -0,0 +1,51 @@
+#include <cstdlib>
+#include <new>
+#include "Arena.h"
+
+ /*******************************************************************************
+ * Arena Class: A bump allocator. Memory is handed out from 64 KiB blocks by    *
+ * moving a pointer forward; nothing is freed on its own. reset() releases      *
+ * everything at once but keeps the first block for the next round, and the     *
+ * destructor frees all blocks. Requests larger than a block get a block of     *
+ * their own.                                                                   *
+ *******************************************************************************/
+Arena::Arena() {
+    current = nullptr;
+    used = 0;
+    capacity = 0;
+}
+
+Arena::~Arena() {
+    for (char *block : blocks) std::free(block);
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+    size_t start = (used + align - 1) & ~(align - 1);
+    if (current == nullptr || start + size > capacity) {
+        grow(size + align);
+        start = (used + align - 1) & ~(align - 1);
+    }
+
+    used = start + size;
+    return current + start;
+}
+
+void Arena::reset() {
+    for (size_t i = 1; i < blocks.size(); i++) std::free(blocks[i]);
+    if (!blocks.empty()) blocks.resize(1);
+
+    current = blocks.empty() ? nullptr : blocks[0];
+    used = 0;
+    capacity = blocks.empty() ? 0 : BLOCK_SIZE;
+}
+
+void Arena::grow(size_t size) {
+    size_t blockSize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+    char *block = static_cast<char *>(std::malloc(blockSize));
+    if (block == nullptr) throw std::bad_alloc();
+
+    blocks.push_back(block);
+    current = block;
+    used = 0;
+    capacity = blockSize;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+class Arena {
+private:
+    static const size_t BLOCK_SIZE = 1 << 16;
+
+    std::vector<char *> blocks;
+    char *current;
+    size_t used, capacity;
+
+    void grow(size_t size);
+
+public:
+    Arena();
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+    void reset();
+
+    template <typename T>
+    T *allocateArray(size_t count) {
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+};
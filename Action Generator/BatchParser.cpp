@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "BatchParser.h"
+
+ /*******************************************************************************
+ * BatchParser Class: Parses many independent inputs on a pool of worker        *
+ * threads. Every worker owns one Parser (and so one state stack) but they all  *
+ * read the same ParseTables. Workers claim inputs in small chunks from a shared*
+ * counter; the results are stored by input index so they can be written out    *
+ * in input order once every worker has finished. Files are read by the worker  *
+ * that parses them so reading is spread over the pool as well. With more than  *
+ * one lane, each worker runs its chunk through an InterleavedParser instead.   *
+ *******************************************************************************/
+BatchParser::BatchParser(const ParseTables &t, unsigned threads, size_t lanes) : tables(t) {
+    numThreads = threads > 0 ? threads : 1;
+    numLanes = lanes > 0 ? lanes : 1;
+    chunkSize = std::max(CHUNK, numLanes * 4);
+}
+
+void BatchParser::addFile(const std::string &path) {
+    inputs.push_back({path, "", true});
+}
+
+// Splits the stream into one input per delimiter ('\n' or '\0'). Empty
+// records are skipped; each input is named by its record number.
+void BatchParser::addStream(std::istream &in, char delimiter) {
+    std::string record;
+    size_t recordNum = 0;
+    while (std::getline(in, record, delimiter)) {
+        recordNum++;
+        if (record.empty()) continue;
+        inputs.push_back({"#" + std::to_string(recordNum), record, false});
+    }
+}
+
+void BatchParser::run() {
+    results.assign(inputs.size(), ParseResult{ParseStatus::NEED_MORE, '\0', 0});
+    loaded.assign(inputs.size(), 1);
+
+    auto worker = numLanes > 1 ? &BatchParser::workInterleaved : &BatchParser::work;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    unsigned extra = numThreads - 1;
+    for (unsigned i = 0; i < extra; i++)
+        workers.emplace_back(worker, this, std::ref(next));
+
+    (this->*worker)(next);
+    for (auto &worker : workers) worker.join();
+}
+
+void BatchParser::work(std::atomic<size_t> &next) {
+    Parser parser(tables);
+    size_t start;
+    while ((start = next.fetch_add(chunkSize)) < inputs.size()) {
+        size_t end = std::min(start + chunkSize, inputs.size());
+        for (size_t i = start; i < end; i++) {
+            BatchInput &input = inputs[i];
+            if (input.isFile && !load(input)) {
+                loaded[i] = 0;
+                continue;
+            }
+
+            const char *data = input.data.data();
+            results[i] = parser.parse(data, data + input.data.size());
+
+            // file contents are no longer needed once parsed
+            if (input.isFile) std::string().swap(input.data);
+        }
+    }
+}
+
+// Claims chunks like work(), but loads the whole chunk first and parses it
+// with the lanes of one InterleavedParser.
+void BatchParser::workInterleaved(std::atomic<size_t> &next) {
+    InterleavedParser parser(tables, numLanes);
+    std::vector<ParseInput> chunk;
+    std::vector<ParseResult> chunkResults;
+    std::vector<size_t> indices;
+    size_t start;
+    while ((start = next.fetch_add(chunkSize)) < inputs.size()) {
+        size_t end = std::min(start + chunkSize, inputs.size());
+        chunk.clear();
+        indices.clear();
+        for (size_t i = start; i < end; i++) {
+            BatchInput &input = inputs[i];
+            if (input.isFile && !load(input)) {
+                loaded[i] = 0;
+                continue;
+            }
+            chunk.push_back({input.data.data(), input.data.data() + input.data.size()});
+            indices.push_back(i);
+        }
+
+        chunkResults.resize(chunk.size());
+        parser.parse(chunk, chunkResults.data());
+        for (size_t i = 0; i < indices.size(); i++) {
+            results[indices[i]] = chunkResults[i];
+            if (inputs[indices[i]].isFile) std::string().swap(inputs[indices[i]].data);
+        }
+    }
+}
+
+bool BatchParser::load(BatchInput &input) {
+    std::ifstream file(input.name, std::ios::binary);
+    if (!file) return false;
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    input.data = contents.str();
+    return true;
+}
+
+// Writes one "name: result" line per input, in the order they were added
+void BatchParser::writeResults(std::ostream &out) const {
+    for (size_t i = 0; i < inputs.size(); i++) {
+        out << inputs[i].name << ": ";
+        if (!loaded[i]) out << "Could not open file";
+        else out << describeResult(results[i]);
+        out << '\n';
+    }
+    out.flush();
+}
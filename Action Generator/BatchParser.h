@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "InterleavedParser.h"
+
+struct BatchInput {
+    std::string name;
+    std::string data;
+    bool isFile;
+};
+
+class BatchParser {
+private:
+    static const size_t CHUNK = 16;
+
+    const ParseTables &tables;
+    unsigned numThreads;
+    size_t numLanes;
+    size_t chunkSize;
+    std::vector<BatchInput> inputs;
+    std::vector<ParseResult> results;
+    std::vector<char> loaded;
+
+    void work(std::atomic<size_t> &next);
+    void workInterleaved(std::atomic<size_t> &next);
+    bool load(BatchInput &input);
+
+public:
+    BatchParser(const ParseTables &t, unsigned threads, size_t lanes = 1);
+    void addFile(const std::string &path);
+    void addStream(std::istream &in, char delimiter);
+    size_t size() const { return inputs.size(); }
+    void run();
+    void writeResults(std::ostream &out) const;
+};
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <map>
+#include "Grammar.h"
+#include "GrammarAnalysis.h"
+
+ /*******************************************************************************
+ * findUnboundedNonTerminals(): The parse stack holds the symbols of every      *
+ * production that is still open. A production A->aBb opens B with a already on *
+ * the stack, so if B can derive A again (through any chain of such openings),  *
+ * each round adds a to the stack and its depth has no bound. Left recursion    *
+ * (A->Ab, where a is empty) reduces A before it opens the next one and is      *
+ * harmless. The nonterminals on a derivation cycle that includes at least one  *
+ * nonempty prefix are returned, in the order their productions appear.         *
+ *******************************************************************************/
+std::vector<char> findUnboundedNonTerminals(const Grammar& grammar) {
+    const std::vector<Production>& prods = grammar.getProductions();
+    std::vector<char> nonTerms;
+    for (auto& prod : prods) {
+        char head = prod.getHead()[0];
+        if (std::find(nonTerms.begin(), nonTerms.end(), head) == nonTerms.end()) nonTerms.push_back(head);
+    }
+
+    std::map<char, int> index;
+    for (size_t i = 0; i < nonTerms.size(); i++) index[nonTerms[i]] = i;
+
+    // reach[a][b]: a derives a string containing b; grows[a][b]: a has a
+    // production with b after at least one other symbol
+    size_t n = nonTerms.size();
+    std::vector<std::vector<bool>> reach(n, std::vector<bool>(n, false));
+    std::vector<std::vector<bool>> grows(n, std::vector<bool>(n, false));
+    for (auto& prod : prods) {
+        int head = index[prod.getHead()[0]];
+        const std::string& body = prod.getBody();
+        for (size_t pos = 0; pos < body.size(); pos++) {
+            if (index.find(body[pos]) == index.end()) continue;
+            int symbol = index[body[pos]];
+            reach[head][symbol] = true;
+            if (pos > 0) grows[head][symbol] = true;
+        }
+    }
+
+    for (size_t k = 0; k < n; k++)
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                if (reach[i][k] && reach[k][j]) reach[i][j] = true;
+
+    std::vector<char> unbounded;
+    for (size_t a = 0; a < n; a++) {
+        bool found = false;
+        for (size_t x = 0; x < n && !found; x++) {
+            if (x != a && !reach[a][x]) continue;
+            for (size_t y = 0; y < n && !found; y++) {
+                if (grows[x][y] && (y == a || reach[y][a])) found = true;
+            }
+        }
+        if (found) unbounded.push_back(nonTerms[a]);
+    }
+
+    return unbounded;
+}
+
+ /*******************************************************************************
+ * rewriteRightRecursion(): Turns simple right-recursive lists into left-       *
+ * recursive ones, which parse in constant stack depth. A nonterminal qualifies *
+ * when it has exactly two productions, A->xA and either A->x or A->, with x a  *
+ * nonempty string not containing A:                                            *
+ *      A->xA | x   becomes   A->Ax | x     (one or more x)                     *
+ *      A->xA |     becomes   A->Ax |       (zero or more x)                    *
+ * The language is the same; the parse trees (and so the reductions) are not.   *
+ * Each rewritten production is described in rewritten.                         *
+ *******************************************************************************/
+Grammar rewriteRightRecursion(const Grammar& grammar, std::vector<std::string>& rewritten) {
+    std::vector<Production> prods = grammar.getProductions();
+    std::map<std::string, std::vector<int>> byHead;
+    for (size_t i = 0; i < prods.size(); i++) byHead[prods[i].getHead()].push_back(i);
+
+    for (auto& entry : byHead) {
+        const std::string& head = entry.first;
+        if (head == "'" || entry.second.size() != 2) continue;
+
+        for (int which = 0; which < 2; which++) {
+            Production& recursive = prods[entry.second[which]];
+            const Production& other = prods[entry.second[1 - which]];
+            const std::string& body = recursive.getBody();
+            if (body.size() < 2 || body.back() != head[0]) continue;
+
+            std::string prefix = body.substr(0, body.size() - 1);
+            if (prefix.find(head[0]) != std::string::npos) continue;
+            if (other.getBody() != prefix && !other.getBody().empty()) continue;
+
+            rewritten.push_back(head + "->" + body + " as " + head + "->" + head + prefix);
+            recursive = Production(recursive.getId(), head, head + prefix);
+            break;
+        }
+    }
+
+    std::map<std::string, std::vector<std::string>> prodMap;
+    for (auto& prod : prods) prodMap[prod.getHead()].push_back(prod.getBody());
+    return {prodMap, prods};
+}
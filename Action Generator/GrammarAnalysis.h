@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class Grammar;
+
+std::vector<char> findUnboundedNonTerminals(const Grammar& grammar);
+Grammar rewriteRightRecursion(const Grammar& grammar, std::vector<std::string>& rewritten);
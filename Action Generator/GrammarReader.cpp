@@ -0,0 +1,106 @@
+#include <iostream>
+#include "constants.h"
+#include "Grammar.h"
+#include "GrammarReader.h"
+
+// The input readers shared by gentable and gensent: both start from the
+// Augmented Grammar section of items.txt on standard in.
+
+ /*******************************************************************************
+ * getHeader(): For each section in the input, there is an Augmented Grammar,   *
+ * Follows information, and an LR(0) Set. These have specific headers that are  *
+ * defines in the constants.h file and have to correspond correctly to the input*
+ * otherwise, there's an error and the program exits. The header (title and line*
+ * ) must match the constant.                                                   *
+ *******************************************************************************/
+void getHeader(const std::string& header, const std::string& line) {
+    std::string input;
+    std::getline(std::cin, input);
+    if (input != header) {
+        printExpectedError(header, input);
+        exit(0);
+    }
+
+    std::getline(std::cin, input);
+    if (input != line) {
+        printExpectedError(line, input);
+        exit(0);
+    }
+}
+
+ /*******************************************************************************
+ * cleanProduction(): From the Grammar section, the line is cleaned and added   *
+ * as a production object. If there's no arrow, the production is invalid. Also *
+ * checks if the nonterminal symbols are proper (upper and alphabetic or ').    *
+ * Checks that the production body only contains valid symbols.                 *
+ *******************************************************************************/
+std::pair<std::string, std::string> cleanProduction(const std::string& prod) {
+    std::string arrow = "->";
+    size_t locationOfArrow = prod.find(arrow);
+    if (locationOfArrow == std::string::npos) {
+        std::cerr << "Invalid production: " << prod << std::endl;
+        exit(0);
+    }
+
+    std::string head = prod.substr(0, locationOfArrow);
+    if (!(isupper(head[0]) && isalpha(head[0])) && head[0] != '\'') {
+        std::cerr << "Invalid nonterm " << head[0] << std::endl;
+        exit(0);
+    }
+
+    std::string body = prod.substr(locationOfArrow + 2, prod.length());
+    size_t errorPos = std::string::npos;
+    if (body.find(' ') != errorPos || body.find('\t') != errorPos ||
+            body.find('$') != errorPos || body.find('\n') != errorPos ||
+            body.find('\'') != errorPos) {
+        std::cerr << "Invalid production: " << prod << std::endl;
+        exit(0);
+    }
+
+    return {head, body};
+}
+
+ /*******************************************************************************
+ * getAugmentedGrammar(): Goes through each line of the Grammar section and     *
+ * ensures a valid production. If it's valid, a production object is passed back*
+ * and stored into the production map and the production vector. These two DS   *
+ * create the Grammar. This way, the productions are in indexed order.          *
+ *******************************************************************************/
+Grammar getAugmentedGrammar() {
+    getHeader(AUGMENTED, AUGMENTED_LINE);
+
+    std::string input;
+    int i = 0;
+    std::vector<Production> prods;
+    std::map<std::string, std::vector<std::string>> prodMap;
+
+    std::getline(std::cin, input);
+    while (!input.empty()) {
+        std::pair<std::string, std::string> pair = cleanProduction(input);
+        std::string head, body;
+        Production currProd(i, pair.first, pair.second);
+
+        if (i == 0 && currProd.getHead() != "'") {
+            std::cerr << "Invalid start symbol for Augmented Grammar" << std::endl;
+            exit(0);
+        }
+
+        if (i > 0 && currProd.getHead() == "'") {
+            std::cerr << "Invalid nonterm '" << std::endl;
+            exit(0);
+        }
+
+        prods.push_back(currProd);
+        prodMap[currProd.getHead()].push_back(currProd.getBody());
+        std::getline(std::cin, input);
+        i++;
+    }
+
+    return {prodMap, prods};
+}
+
+void printExpectedError(const std::string& expected, const std::string& got) {
+    std::cerr << "Expected:\n" << "   " << expected << std::endl;
+    std::cerr << "Got:\n" << "   " << got << std::endl;
+    exit(0);
+}
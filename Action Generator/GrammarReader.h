@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+#include <utility>
+
+class Grammar;
+
+void getHeader(const std::string& header, const std::string& line);
+std::pair<std::string, std::string> cleanProduction(const std::string& prod);
+Grammar getAugmentedGrammar();
+void printExpectedError(const std::string& expected, const std::string& got);
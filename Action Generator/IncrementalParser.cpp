@@ -0,0 +1,92 @@
+#include <cctype>
+#include "IncrementalParser.h"
+
+ /*******************************************************************************
+ * IncrementalParser Class: Parses an input and saves a checkpoint every        *
+ * `interval` tokens: the byte offset of the next token, the number of tokens   *
+ * before it and a copy of the state stack. The stack at that point only        *
+ * depends on the text before the offset.                                       *
+ * After an edit, reparse() resumes from the last checkpoint at or before the   *
+ * edit instead of from state 0. Once past the edited text, whenever the parse  *
+ * reaches the (shifted) offset of an old checkpoint with an identical state    *
+ * stack, the rest of the parse must go exactly as before: the old result is    *
+ * kept, the old checkpoints are shifted into place and parsing stops. The cost *
+ * of a reparse therefore depends on the size of the edit, not of the input.    *
+ * Listeners are not supported, since only part of the input is reparsed.       *
+ *******************************************************************************/
+IncrementalParser::IncrementalParser(const ParseTables &tables, size_t interval) : parser(tables) {
+    this->interval = interval > 0 ? interval : 1;
+    result = {ParseStatus::NEED_MORE, '\0', 0};
+    tokensParsed = 0;
+}
+
+const ParseResult &IncrementalParser::parse(const std::string &input) {
+    parser.reset();
+    checkpoints.clear();
+    return run(input, 0, 0, 0, input.size(), 0);
+}
+
+// The bytes [editStart, editStart + oldLength) of the previously parsed input
+// were replaced by newLength bytes, giving input.
+const ParseResult &IncrementalParser::reparse(const std::string &input, size_t editStart,
+                                              size_t oldLength, size_t newLength) {
+    size_t keep = 0;
+    while (keep < checkpoints.size() && checkpoints[keep].offset <= editStart) keep++;
+    if (keep == 0) return parse(input);
+
+    const Checkpoint &resume = checkpoints[keep - 1];
+    parser.restore(resume.stack);
+    long delta = (long) newLength - (long) oldLength;
+    return run(input, resume.offset, resume.tokens, keep - 1, editStart + newLength, delta);
+}
+
+ /*******************************************************************************
+ * run: Parses input from offset start with `tokens` tokens already behind it.  *
+ * Checkpoints [0, keep] are still valid; the ones after them belong to the old *
+ * parse and are compared against once the parse reaches changeEnd. New         *
+ * checkpoints are collected separately and spliced in at the end.              *
+ *******************************************************************************/
+const ParseResult &IncrementalParser::run(const std::string &input, size_t start, size_t tokens,
+                                          size_t keep, size_t changeEnd, long delta) {
+    std::vector<Checkpoint> fresh;
+    size_t old = keep + 1;
+    size_t startTokens = tokens;
+    // the resume checkpoint itself is kept, not saved again
+    bool skipSave = !checkpoints.empty();
+
+    for (size_t p = start; p < input.size() && input[p] != '$'; p++) {
+        if (isspace((unsigned char) input[p])) continue;
+
+        if (p >= changeEnd) {
+            while (old < checkpoints.size() && (long) checkpoints[old].offset + delta < (long) p) old++;
+            if (old < checkpoints.size() && (long) checkpoints[old].offset + delta == (long) p &&
+                checkpoints[old].stack == parser.getStack()) {
+                long tokenDelta = (long) tokens - (long) checkpoints[old].tokens;
+                checkpoints.erase(checkpoints.begin() + keep + 1, checkpoints.begin() + old);
+                for (size_t i = keep + 1; i < checkpoints.size(); i++) {
+                    checkpoints[i].offset += delta;
+                    checkpoints[i].tokens += tokenDelta;
+                }
+                checkpoints.insert(checkpoints.begin() + keep + 1,
+                                   std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+                tokensParsed = tokens - startTokens;
+                return result;
+            }
+        }
+
+        if (tokens % interval == 0 && !skipSave)
+            fresh.push_back({p, tokens, parser.getStack()});
+        skipSave = false;
+
+        tokens++;
+        if (parser.consume(input[p]) != ParseStatus::NEED_MORE) break;
+    }
+
+    parser.finish();
+    result = parser.getResult();
+    tokensParsed = tokens - startTokens;
+
+    checkpoints.resize(checkpoints.empty() ? 0 : keep + 1);
+    for (auto &checkpoint : fresh) checkpoints.push_back(std::move(checkpoint));
+    return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Parser.h"
+
+class IncrementalParser {
+private:
+    struct Checkpoint {
+        size_t offset;
+        size_t tokens;
+        std::vector<int> stack;
+    };
+
+    size_t interval;
+    Parser parser;
+    std::vector<Checkpoint> checkpoints;
+    ParseResult result;
+    size_t tokensParsed;
+
+    const ParseResult &run(const std::string &input, size_t start, size_t tokens, size_t keep,
+                           size_t changeEnd, long delta);
+
+public:
+    IncrementalParser(const ParseTables &tables, size_t interval = 64);
+    const ParseResult &parse(const std::string &input);
+    const ParseResult &reparse(const std::string &input, size_t editStart, size_t oldLength, size_t newLength);
+    const ParseResult &getResult() const { return result; }
+    size_t getTokensParsed() const { return tokensParsed; }
+    size_t numCheckpoints() const { return checkpoints.size(); }
+};
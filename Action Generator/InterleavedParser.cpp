@@ -0,0 +1,127 @@
+#include <cctype>
+#include "InterleavedParser.h"
+#include "ParseStats.h"
+
+ /*******************************************************************************
+ * InterleavedParser Class: Advances several independent parses ("lanes") in    *
+ * lock-step on one thread. Each lane keeps its own state stack and input       *
+ * cursor. A lane makes a single table access per turn and then prefetches the  *
+ * cell it needs next, so by the time the round-robin comes back to it, the     *
+ * cell is usually in cache; the memory latency of one lane hides behind the    *
+ * work of the others. A reduce takes two turns: the action lookup pops the     *
+ * stack and prefetches the go_to cell, the next turn pushes the goto state.    *
+ * The results are the same as running a Parser over each input in turn.        *
+ *******************************************************************************/
+InterleavedParser::InterleavedParser(const ParseTables &t, size_t numLanes, size_t limit) : tables(t) {
+    stackLimit = limit;
+    lanes.resize(numLanes > 0 ? numLanes : 1);
+    for (auto &lane : lanes) {
+        lane.stateStack.reserve(limit);
+        lane.active = false;
+    }
+}
+
+// Parses every input, writing its result to the matching slot of results
+void InterleavedParser::parse(const std::vector<ParseInput> &inputs, ParseResult *results) {
+    size_t next = 0;
+    bool busy;
+    do {
+        busy = false;
+        for (auto &lane : lanes) {
+            if (!lane.active && next < inputs.size()) {
+                start(lane, inputs[next], next, results);
+                next++;
+            }
+
+            if (lane.active) {
+                step(lane, results);
+                busy = true;
+            }
+        }
+    } while (busy || next < inputs.size());
+}
+
+void InterleavedParser::start(Lane &lane, const ParseInput &input, size_t index, ParseResult *results) {
+    lane.stateStack.clear();
+    lane.stateStack.push_back(0);
+    lane.cursor = input.begin;
+    lane.end = input.end;
+    lane.pendingLHS = -1;
+    lane.chain = 0;
+    lane.input = index;
+    lane.active = true;
+    nextToken(lane, results);
+    if (lane.active) prefetch(lane);
+}
+
+// Moves the cursor to the next token, skipping white space. Running out of
+// input or reaching '$' makes the end-of-input token the lookahead.
+void InterleavedParser::nextToken(Lane &lane, ParseResult *results) {
+    while (lane.cursor != lane.end && isspace((unsigned char) *lane.cursor)) lane.cursor++;
+
+    lane.token = (lane.cursor == lane.end) ? '$' : *lane.cursor;
+    lane.term = tables.getTermIndex(lane.token);
+    if (lane.token == '$') lane.cursor = lane.end;
+    if (lane.term == -1) stop(lane, results, ParseStatus::BAD_TOKEN, lane.stateStack.back());
+}
+
+void InterleavedParser::step(Lane &lane, ParseResult *results) {
+    // second half of a reduce: push the goto state
+    if (lane.pendingLHS != -1) {
+        int currentState = lane.stateStack.back();
+        lane.stateStack.push_back(tables.getGoto(currentState, lane.pendingLHS));
+        lane.pendingLHS = -1;
+        PARSE_STATS(depth(lane.stateStack.size()));
+        if (lane.stateStack.size() >= stackLimit) {
+            stop(lane, results, ParseStatus::OVERFLOW, currentState);
+            return;
+        }
+        prefetch(lane);
+        return;
+    }
+
+    int currentState = lane.stateStack.back();
+    char act = tables.getAction(currentState, lane.term);
+    int actionNum = tables.getActionNum(currentState, lane.term);
+    PARSE_STATS(visit(currentState));
+    if (act != 'r') {
+        PARSE_STATS(chain(lane.chain));
+        lane.chain = 0;
+    }
+
+    if (act == 'r') {
+        PARSE_STATS(reduce(actionNum));
+        lane.chain++;
+        lane.stateStack.resize(lane.stateStack.size() - tables.reduceNum[actionNum]);
+        lane.pendingLHS = tables.reduceLHS[actionNum];
+        int below = lane.stateStack.back();
+        __builtin_prefetch(&tables.goTo[below * tables.numNonTerms + lane.pendingLHS]);
+    } else if (act == 'e') {
+        stop(lane, results, ParseStatus::ERROR, currentState);
+    } else if (act == 'a' || lane.token == '$') {
+        stop(lane, results, ParseStatus::ACCEPT, currentState);
+    } else {
+        lane.stateStack.push_back(actionNum);
+        PARSE_STATS(shift(lane.term));
+        PARSE_STATS(depth(lane.stateStack.size()));
+        if (lane.stateStack.size() >= stackLimit) {
+            stop(lane, results, ParseStatus::OVERFLOW, currentState);
+            return;
+        }
+        lane.cursor++;
+        nextToken(lane, results);
+        if (lane.active) prefetch(lane);
+    }
+}
+
+// Requests the action cells the lane will read on its next turn
+void InterleavedParser::prefetch(const Lane &lane) const {
+    size_t cell = (size_t) lane.stateStack.back() * tables.numTerms + lane.term;
+    __builtin_prefetch(&tables.action[cell]);
+    __builtin_prefetch(&tables.actionNum[cell]);
+}
+
+void InterleavedParser::stop(Lane &lane, ParseResult *results, ParseStatus status, int state) {
+    results[lane.input] = {status, lane.token, tables.origState[state]};
+    lane.active = false;
+}
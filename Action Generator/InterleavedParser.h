@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "Parser.h"
+
+struct ParseInput {
+    const char *begin;
+    const char *end;
+};
+
+class InterleavedParser {
+private:
+    struct Lane {
+        std::vector<int> stateStack;
+        const char *cursor, *end;
+        char token;
+        int term;
+        int pendingLHS;
+        size_t chain;
+        size_t input;
+        bool active;
+    };
+
+    const ParseTables &tables;
+    size_t stackLimit;
+    std::vector<Lane> lanes;
+
+    void start(Lane &lane, const ParseInput &input, size_t index, ParseResult *results);
+    void nextToken(Lane &lane, ParseResult *results);
+    void step(Lane &lane, ParseResult *results);
+    void prefetch(const Lane &lane) const;
+    void stop(Lane &lane, ParseResult *results, ParseStatus status, int state);
+
+public:
+    InterleavedParser(const ParseTables &t, size_t numLanes, size_t limit = MAX_STACK);
+    void parse(const std::vector<ParseInput> &inputs, ParseResult *results);
+};
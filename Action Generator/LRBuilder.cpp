@@ -0,0 +1,177 @@
+#include <algorithm>
+#include "Grammar.h"
+#include "Follows.h"
+#include "LRSet.h"
+#include "LRBuilder.h"
+
+ /*******************************************************************************
+ * LRBuilder Class: Builds the Follows and the LR(0) sets of a grammar inside   *
+ * gentable, for when the grammar was changed after items.txt was written (the  *
+ * -r rewrite). The results are laid out like the ones read from items.txt:     *
+ * nonterminals are indexed in the order their productions first appear, the    *
+ * items of a set list the kernel first and then the closure in grammar order,  *
+ * and the sets are numbered breadth first from I0, following the goto symbols  *
+ * in the order they appear in the items.                                       *
+ *******************************************************************************/
+LRBuilder::LRBuilder(const Grammar& grammar) {
+    for (auto& prod : grammar.getProductions()) {
+        char head = prod.getHead()[0];
+        prods.push_back({head, prod.getBody()});
+        if (head != '\'' && std::find(nonTerms.begin(), nonTerms.end(), head) == nonTerms.end())
+            nonTerms.push_back(head);
+    }
+
+    terms = grammar.getTermArray();
+    computeFirst();
+}
+
+bool LRBuilder::isNonTerminal(char symbol) const {
+    return symbol == '\'' || std::find(nonTerms.begin(), nonTerms.end(), symbol) != nonTerms.end();
+}
+
+// Computes the nullable nonterminals and the FIRST sets by iterating over
+// the productions until nothing changes.
+void LRBuilder::computeFirst() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& prod : prods) {
+            std::set<char>& headFirst = first[prod.first];
+            size_t before = headFirst.size();
+            bool allNullable = true;
+            for (char symbol : prod.second) {
+                if (!isNonTerminal(symbol)) {
+                    headFirst.insert(symbol);
+                    allNullable = false;
+                    break;
+                }
+
+                headFirst.insert(first[symbol].begin(), first[symbol].end());
+                if (nullable.find(symbol) == nullable.end()) {
+                    allNullable = false;
+                    break;
+                }
+            }
+
+            if (allNullable && nullable.insert(prod.first).second) changed = true;
+            if (headFirst.size() != before) changed = true;
+        }
+    }
+}
+
+ /*******************************************************************************
+ * getFollows(): FOLLOW(S) of the start symbol holds '$'. For every A->xBy,     *
+ * FOLLOW(B) gets FIRST(y), and FOLLOW(A) too if y can derive the empty string. *
+ * The follow characters of each nonterminal are listed in terminal order.      *
+ *******************************************************************************/
+Follows LRBuilder::getFollows() const {
+    std::map<char, std::set<char>> follow;
+    follow['\''].insert('$');
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& prod : prods) {
+            const std::string& body = prod.second;
+            for (size_t pos = 0; pos < body.size(); pos++) {
+                if (!isNonTerminal(body[pos])) continue;
+
+                std::set<char>& symbolFollow = follow[body[pos]];
+                size_t before = symbolFollow.size();
+                bool restNullable = true;
+                for (size_t next = pos + 1; next < body.size() && restNullable; next++) {
+                    char symbol = body[next];
+                    if (!isNonTerminal(symbol)) {
+                        symbolFollow.insert(symbol);
+                        restNullable = false;
+                    } else {
+                        const std::set<char>& symbolFirst = first.at(symbol);
+                        symbolFollow.insert(symbolFirst.begin(), symbolFirst.end());
+                        restNullable = nullable.find(symbol) != nullable.end();
+                    }
+                }
+
+                if (restNullable) symbolFollow.insert(follow[prod.first].begin(), follow[prod.first].end());
+                if (symbolFollow.size() != before) changed = true;
+            }
+        }
+    }
+
+    std::set<char> nonTerminalSet(nonTerms.begin(), nonTerms.end());
+    std::map<char, std::vector<char>> followsMap;
+    std::map<char, int> nonTermIndex;
+    for (size_t i = 0; i < nonTerms.size(); i++) {
+        nonTermIndex[nonTerms[i]] = i;
+        std::vector<char>& chars = followsMap[nonTerms[i]];
+        for (char term : terms) {
+            if (follow[nonTerms[i]].count(term)) chars.push_back(term);
+        }
+    }
+
+    return {nonTerminalSet, followsMap, nonTermIndex};
+}
+
+// Adds an item B->@z for every production of each B that appears right
+// after the dot, until no new items appear.
+std::vector<LRBuilder::LRItem> LRBuilder::closure(std::vector<LRItem> items) const {
+    for (size_t i = 0; i < items.size(); i++) {
+        const std::string& body = prods[items[i].first].second;
+        if (items[i].second == body.size() || !isNonTerminal(body[items[i].second])) continue;
+
+        char symbol = body[items[i].second];
+        for (size_t prod = 0; prod < prods.size(); prod++) {
+            if (prods[prod].first != symbol) continue;
+            LRItem item = {prod, 0};
+            if (std::find(items.begin(), items.end(), item) == items.end()) items.push_back(item);
+        }
+    }
+
+    return items;
+}
+
+LRSet LRBuilder::getSets() const {
+    std::vector<std::vector<LRItem>> sets = {closure({{0, 0}})};
+    std::map<std::vector<LRItem>, int> kernels = {{{{0, 0}}, 0}};
+    std::vector<std::map<char, int>> gotoMaps;
+
+    for (size_t setNum = 0; setNum < sets.size(); setNum++) {
+        std::vector<char> symbols;
+        for (auto& item : sets[setNum]) {
+            const std::string& body = prods[item.first].second;
+            if (item.second == body.size()) continue;
+            if (std::find(symbols.begin(), symbols.end(), body[item.second]) == symbols.end())
+                symbols.push_back(body[item.second]);
+        }
+
+        std::map<char, int> gotoMap;
+        for (char symbol : symbols) {
+            std::vector<LRItem> kernel;
+            for (auto& item : sets[setNum]) {
+                const std::string& body = prods[item.first].second;
+                if (item.second < body.size() && body[item.second] == symbol)
+                    kernel.push_back({item.first, item.second + 1});
+            }
+
+            auto found = kernels.find(kernel);
+            if (found == kernels.end()) {
+                found = kernels.insert({kernel, (int) sets.size()}).first;
+                sets.push_back(closure(kernel));
+            }
+            gotoMap[symbol] = found->second;
+        }
+        gotoMaps.push_back(gotoMap);
+    }
+
+    std::vector<State> states;
+    for (size_t setNum = 0; setNum < sets.size(); setNum++) {
+        std::vector<Item> items;
+        for (auto& item : sets[setNum]) {
+            std::string body = prods[item.first].second;
+            body.insert(item.second, "@");
+            items.push_back({prods[item.first].first, body});
+        }
+        states.push_back(State((int) setNum, items, gotoMaps[setNum]));
+    }
+
+    return {states};
+}
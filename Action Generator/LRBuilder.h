@@ -0,0 +1,30 @@
+#pragma once
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Grammar;
+class Follows;
+class LRSet;
+
+class LRBuilder {
+private:
+    typedef std::pair<int, size_t> LRItem;
+
+    std::vector<std::pair<char, std::string>> prods;
+    std::vector<char> nonTerms;
+    std::vector<char> terms;
+    std::set<char> nullable;
+    std::map<char, std::set<char>> first;
+
+    bool isNonTerminal(char symbol) const;
+    void computeFirst();
+    std::vector<LRItem> closure(std::vector<LRItem> items) const;
+
+public:
+    LRBuilder(const Grammar& grammar);
+    Follows getFollows() const;
+    LRSet getSets() const;
+};
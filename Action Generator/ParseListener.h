@@ -0,0 +1,9 @@
+#pragma once
+
+class ParseListener {
+public:
+    virtual ~ParseListener() {}
+    virtual void start() {}
+    virtual void shift(char) {}
+    virtual void reduce(int, int) {}
+};
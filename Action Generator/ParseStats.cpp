@@ -0,0 +1,108 @@
+#include "ParseStats.h"
+
+struct ParseStats::Registration {
+    ParseStats stats;
+    Registration();
+    ~Registration();
+};
+
+std::mutex ParseStats::registryLock;
+std::vector<ParseStats *> ParseStats::registry;
+ParseStats ParseStats::retired;
+
+ /*******************************************************************************
+ * ParseStats Class: Hot-path counters for the parse loops. Parser,             *
+ * InterleavedParser and SplitParser's speculation call them through the        *
+ * PARSE_STATS macro (the speculation per segment, merged only for the          *
+ * segments that are reused), which is empty unless cparse is built with        *
+ * -DCPARSE_STATS (make cparse-stats), so the normal build pays nothing. The    *
+ * counters are:                                                                *
+ *   states:        action-table lookups made in each state, by LR(0) set       *
+ *                  number, so the profile survives gentable -p renumbering     *
+ *   shifts:        shifts of each terminal                                     *
+ *   reductions:    reductions by each production                               *
+ *   reduce_chains: how many lookaheads triggered a chain of N reductions       *
+ *   max_depth:     the deepest the state stack got                             *
+ * Every thread counts into its own ParseStats, so the counters need no locks.  *
+ * A thread's counters are registered on first use and merged into the          *
+ * retired totals when the thread exits; collect() sums them all.               *
+ *******************************************************************************/
+ParseStats::ParseStats() {
+    const ParseTables &tables = getParseTables();
+    stateVisits.assign(tables.numStates, 0);
+    terminalShifts.assign(tables.numTerms, 0);
+    reductions.assign(tables.numProds, 0);
+    maxDepth = 0;
+    origState = tables.origState;
+}
+
+void ParseStats::chain(size_t length) {
+    if (length >= chainLengths.size()) chainLengths.resize(length + 1, 0);
+    chainLengths[length]++;
+}
+
+void ParseStats::merge(const ParseStats &other) {
+    for (size_t i = 0; i < stateVisits.size(); i++) stateVisits[i] += other.stateVisits[i];
+    for (size_t i = 0; i < terminalShifts.size(); i++) terminalShifts[i] += other.terminalShifts[i];
+    for (size_t i = 0; i < reductions.size(); i++) reductions[i] += other.reductions[i];
+
+    if (other.chainLengths.size() > chainLengths.size()) chainLengths.resize(other.chainLengths.size(), 0);
+    for (size_t i = 0; i < other.chainLengths.size(); i++) chainLengths[i] += other.chainLengths[i];
+    depth(other.maxDepth);
+}
+
+ParseStats::Registration::Registration() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    registry.push_back(&stats);
+}
+
+ParseStats::Registration::~Registration() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    retired.merge(stats);
+    for (size_t i = 0; i < registry.size(); i++) {
+        if (registry[i] != &stats) continue;
+        registry.erase(registry.begin() + i);
+        break;
+    }
+}
+
+// The calling thread's counters
+ParseStats &ParseStats::local() {
+    thread_local Registration registration;
+    return registration.stats;
+}
+
+// The totals of every thread so far. Threads still running should be idle.
+ParseStats ParseStats::collect() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    ParseStats total = retired;
+    for (ParseStats *stats : registry) total.merge(*stats);
+    return total;
+}
+
+static void writeArray(std::ostream &out, const std::vector<unsigned long> &values) {
+    out << '[';
+    for (size_t i = 0; i < values.size(); i++) out << (i > 0 ? ", " : "") << values[i];
+    out << ']';
+}
+
+// Writes the counters as a JSON object. "states" is indexed by state number,
+// which is the form gentable reads back as a profile.
+void ParseStats::writeJSON(std::ostream &out, const ParseTables &tables) const {
+    out << "{\n  \"num_states\": " << tables.numStates << ",\n  \"states\": ";
+    writeArray(out, stateVisits);
+
+    out << ",\n  \"shifts\": {";
+    for (int term = 0; term < tables.numTerms; term++) {
+        char token = tables.tokens[term];
+        out << (term > 0 ? ", " : "") << '"';
+        if (token == '"' || token == '\\') out << '\\';
+        out << token << "\": " << terminalShifts[term];
+    }
+
+    out << "},\n  \"reductions\": ";
+    writeArray(out, reductions);
+    out << ",\n  \"reduce_chains\": ";
+    writeArray(out, chainLengths);
+    out << ",\n  \"max_depth\": " << maxDepth << "\n}\n";
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "ParseTables.h"
+
+#ifdef CPARSE_STATS
+#define PARSE_STATS(call) ParseStats::local().call
+#else
+#define PARSE_STATS(call)
+#endif
+
+class ParseStats {
+private:
+    std::vector<unsigned long> stateVisits;
+    std::vector<unsigned long> terminalShifts;
+    std::vector<unsigned long> reductions;
+    std::vector<unsigned long> chainLengths;
+    size_t maxDepth;
+    const int *origState;
+
+    static std::mutex registryLock;
+    static std::vector<ParseStats *> registry;
+    static ParseStats retired;
+
+    struct Registration;
+
+public:
+    ParseStats();
+    void visit(int state) { stateVisits[origState[state]]++; }
+    void shift(int term) { terminalShifts[term]++; }
+    void reduce(int prod) { reductions[prod]++; }
+    void chain(size_t length);
+    void depth(size_t size) { if (size > maxDepth) maxDepth = size; }
+    void merge(const ParseStats &other);
+    void writeJSON(std::ostream &out, const ParseTables &tables) const;
+
+    static ParseStats &local();
+    static ParseStats collect();
+};
@@ -0,0 +1,38 @@
+#include "ParseTables.h"
+#include "tables.h"
+
+// The generated tables.h only defines static arrays, so this is the one
+// translation unit that includes it. Everything else reaches the tables
+// through this read-only view, which is safe to share between threads.
+static ParseTables createParseTables() {
+    ParseTables tables;
+    tables.numStates = NUM_STATES;
+    tables.numTerms = NUM_TERMS;
+    tables.numNonTerms = NUM_NONTERMS;
+    tables.numProds = NUM_PRODS;
+#ifdef MAX_STACK_DEPTH
+    tables.maxDepth = MAX_STACK_DEPTH;
+#else
+    tables.maxDepth = 0;
+#endif
+    tables.action = &action[0][0];
+    tables.actionNum = &action_num[0][0];
+    tables.goTo = &go_to[0][0];
+    tables.reduceNum = reduce_num;
+    tables.reduceLHS = reduce_lhs;
+    tables.tokens = tokens;
+    tables.syncState = sync_state;
+    tables.origState = orig_state;
+
+    // -1 marks a bad token; whitespace is never a token
+    for (int &index : tables.termIndex) index = -1;
+    for (int i = 0; i < NUM_TERMS; i++)
+        tables.termIndex[(unsigned char) tokens[i]] = i;
+
+    return tables;
+}
+
+const ParseTables &getParseTables() {
+    static const ParseTables tables = createParseTables();
+    return tables;
+}
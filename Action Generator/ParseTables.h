@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+
+struct ParseTables {
+    int numStates, numTerms, numNonTerms, numProds;
+    int maxDepth;
+    const char *action;
+    const int *actionNum;
+    const int *goTo;
+    const int *reduceNum;
+    const int *reduceLHS;
+    const char *tokens;
+    const int *syncState;
+    const int *origState;
+    int termIndex[256];
+
+    char getAction(int state, int term) const { return action[state * numTerms + term]; }
+    int getActionNum(int state, int term) const { return actionNum[state * numTerms + term]; }
+    int getGoto(int state, int nonTerm) const { return goTo[state * numNonTerms + nonTerm]; }
+    int getTermIndex(char token) const { return termIndex[(unsigned char) token]; }
+};
+
+const ParseTables &getParseTables();
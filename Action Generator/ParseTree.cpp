@@ -0,0 +1,51 @@
+#include <string>
+#include "ParseTree.h"
+
+ /*******************************************************************************
+ * ParseTree Class: A listener that builds the parse tree while parsing. Every  *
+ * shift creates a leaf for the token, every reduce an interior node whose      *
+ * children are the nodes of the production body. Nodes and child arrays come   *
+ * from an Arena, so the whole tree is freed in one shot when the tree is       *
+ * destroyed or the next parse starts. Leaves have prod -1.                     *
+ *******************************************************************************/
+void ParseTree::start() {
+    arena.reset();
+    nodes.clear();
+}
+
+void ParseTree::shift(char token) {
+    ParseNode *node = arena.allocateArray<ParseNode>(1);
+    *node = {-1, token, 0, nullptr};
+    nodes.push_back(node);
+}
+
+void ParseTree::reduce(int prod, int length) {
+    ParseNode *node = arena.allocateArray<ParseNode>(1);
+    ParseNode **children = length > 0 ? arena.allocateArray<ParseNode *>(length) : nullptr;
+    for (int i = 0; i < length; i++)
+        children[i] = nodes[nodes.size() - length + i];
+
+    *node = {prod, '\0', length, children};
+    nodes.resize(nodes.size() - length);
+    nodes.push_back(node);
+}
+
+// Prints the tree, one node per line, indented by depth. Interior nodes are
+// shown by production number, leaves by their token.
+void ParseTree::print(std::ostream &out) const {
+    std::vector<std::pair<const ParseNode *, int>> pending;
+    if (root()) pending.push_back({root(), 0});
+
+    while (!pending.empty()) {
+        const ParseNode *node = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+
+        out << std::string(depth * 2, ' ');
+        if (node->prod == -1) out << "'" << node->token << "'\n";
+        else out << "reduce " << node->prod << " (NT " << tables.reduceLHS[node->prod] << ")\n";
+
+        for (int i = node->numChildren - 1; i >= 0; i--)
+            pending.push_back({node->children[i], depth + 1});
+    }
+}
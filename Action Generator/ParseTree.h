@@ -0,0 +1,28 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include "Arena.h"
+#include "ParseListener.h"
+#include "ParseTables.h"
+
+struct ParseNode {
+    int prod;
+    char token;
+    int numChildren;
+    ParseNode **children;
+};
+
+class ParseTree : public ParseListener {
+private:
+    const ParseTables &tables;
+    Arena arena;
+    std::vector<ParseNode *> nodes;
+
+public:
+    ParseTree(const ParseTables &t) : tables(t) {}
+    ParseNode *root() const { return nodes.empty() ? nullptr : nodes.back(); }
+    void start() override;
+    void shift(char token) override;
+    void reduce(int prod, int length) override;
+    void print(std::ostream &out) const;
+};
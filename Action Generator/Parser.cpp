@@ -0,0 +1,148 @@
+#include <cctype>
+#include "Parser.h"
+#include "ParseStats.h"
+
+ /*******************************************************************************
+ * Parser Class: The table-driven LR loop that used to live in cparse's main.   *
+ * A Parser only reads the shared ParseTables, so any number of them can run    *
+ * side by side. The parser is push-driven: input is handed over in chunks of   *
+ * any size through feed() (or one token at a time through consume()) and       *
+ * finish() feeds the '$' end-of-input token. The state stack is kept between   *
+ * calls, so a caller can interleave thousands of parses fed from different     *
+ * sources on a few threads without blocking. Once the parse has accepted or    *
+ * failed, the result is kept and further tokens are ignored. An optional       *
+ * ParseListener is told about every shift and reduce (the reduction trace,     *
+ * semantic actions and the parse-tree builder are all listeners).              *
+ * When gentable found the stack depth of the grammar to be bounded below the   *
+ * limit, the stack is allocated at exactly that size and the overflow checks   *
+ * are compiled out of the parse loop.                                          *
+ *******************************************************************************/
+Parser::Parser(const ParseTables &t, ParseListener *l, size_t limit) : tables(t) {
+    listener = l;
+    stackLimit = limit;
+    checkOverflow = tables.maxDepth == 0 || (size_t) tables.maxDepth >= limit;
+    stateStack.reserve(checkOverflow ? limit : tables.maxDepth);
+    reset();
+}
+
+void Parser::reset() {
+    stateStack.clear();
+    stateStack.push_back(0);
+    result = {ParseStatus::NEED_MORE, '\0', 0};
+    if (listener) listener->start();
+}
+
+// Puts the parser back into a state saved earlier with getStack(). The
+// listener is not told; it would have to be restored by its owner.
+void Parser::restore(const std::vector<int> &states) {
+    stateStack = states;
+    result = {ParseStatus::NEED_MORE, '\0', 0};
+}
+
+// Feeds one (non-whitespace) token to the parser. The '$' token ends the input.
+ParseStatus Parser::consume(char token) {
+    if (result.status != ParseStatus::NEED_MORE) return result.status;
+    if (token == '$') return finish();
+
+    int termIndex = tables.getTermIndex(token);
+    if (termIndex == -1) return stop(ParseStatus::BAD_TOKEN, token, stateStack.back());
+
+    if (checkOverflow) return step<true>(token, termIndex);
+    return step<false>(token, termIndex);
+}
+
+// Feeds the next n characters of input. White space is skipped and a '$'
+// ends the input. Returns NEED_MORE until the parse accepts or fails.
+ParseStatus Parser::feed(const char *tokens, size_t n) {
+    for (size_t i = 0; i < n && result.status == ParseStatus::NEED_MORE; i++) {
+        if (isspace((unsigned char) tokens[i])) continue;
+        consume(tokens[i]);
+    }
+
+    return result.status;
+}
+
+// Signifies the end of input. The remaining states on the stack are
+// reduced and the parse either accepts or fails on '$'.
+ParseStatus Parser::finish() {
+    if (result.status != ParseStatus::NEED_MORE) return result.status;
+    if (checkOverflow) return step<true>('$', tables.getTermIndex('$'));
+    return step<false>('$', tables.getTermIndex('$'));
+}
+
+// Parses a whole in-memory input, skipping white space and stopping at '$'
+const ParseResult &Parser::parse(const char *begin, const char *end) {
+    reset();
+    feed(begin, end - begin);
+    finish();
+    return result;
+}
+
+ /*******************************************************************************
+ * step: Tests the token against the action array. While the action is an 'r',  *
+ * the stack is reduced and the goto state pushed. Afterwards the token is      *
+ * either an error, an accept, or shifted onto the stack. The end-of-input      *
+ * token is never shifted: anything but an error accepts. The stack is only     *
+ * checked for overflow when the grammar's depth is not known to be bounded.    *
+ *******************************************************************************/
+template <bool checked>
+ParseStatus Parser::step(char token, int termIndex) {
+    int currentState = stateStack.back();
+    char act = tables.getAction(currentState, termIndex);
+    int actionNum = tables.getActionNum(currentState, termIndex);
+    PARSE_STATS(visit(currentState));
+    size_t chain = 0;
+
+    while (act == 'r') {
+        int length = tables.reduceNum[actionNum];
+        stateStack.resize(stateStack.size() - length);
+        if (listener) listener->reduce(actionNum, length);
+        PARSE_STATS(reduce(actionNum));
+        chain++;
+
+        currentState = stateStack.back();
+        stateStack.push_back(tables.getGoto(currentState, tables.reduceLHS[actionNum]));
+        PARSE_STATS(depth(stateStack.size()));
+        if (checked && stateStack.size() >= stackLimit) return stop(ParseStatus::OVERFLOW, token, currentState);
+        currentState = stateStack.back();
+
+        act = tables.getAction(currentState, termIndex);
+        actionNum = tables.getActionNum(currentState, termIndex);
+        PARSE_STATS(visit(currentState));
+    }
+    PARSE_STATS(chain(chain));
+
+    if (act == 'e') return stop(ParseStatus::ERROR, token, currentState);
+    if (act == 'a' || token == '$') return stop(ParseStatus::ACCEPT, token, currentState);
+
+    stateStack.push_back(actionNum);
+    PARSE_STATS(shift(termIndex));
+    PARSE_STATS(depth(stateStack.size()));
+    if (checked && stateStack.size() >= stackLimit) return stop(ParseStatus::OVERFLOW, token, currentState);
+    if (listener) listener->shift(token);
+    return ParseStatus::NEED_MORE;
+}
+
+// States are reported by their LR(0) set number, whatever order gentable
+// stored them in.
+ParseStatus Parser::stop(ParseStatus status, char token, int state) {
+    result = {status, token, tables.origState[state]};
+    return status;
+}
+
+// The message cparse prints for a finished parse
+std::string describeResult(const ParseResult &result) {
+    switch (result.status) {
+        case ParseStatus::ACCEPT:
+            return "Accept state reached.";
+        case ParseStatus::ERROR:
+            return "Error state on token '" + std::string(1, result.token) +
+                   "' at state " + std::to_string(result.state) + ".";
+        case ParseStatus::BAD_TOKEN:
+            return "Bad token: " + std::string(1, result.token);
+        case ParseStatus::OVERFLOW:
+            return "Stack overflow occurred.";
+        default:
+            return "Incomplete input.";
+    }
+}
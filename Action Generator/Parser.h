@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ParseTables.h"
+#include "ParseListener.h"
+
+const size_t MAX_STACK = 100;
+
+enum class ParseStatus { NEED_MORE, ACCEPT, ERROR, BAD_TOKEN, OVERFLOW };
+
+struct ParseResult {
+    ParseStatus status;
+    char token;
+    int state;
+};
+
+class Parser {
+private:
+    const ParseTables &tables;
+    ParseListener *listener;
+    size_t stackLimit;
+    bool checkOverflow;
+    std::vector<int> stateStack;
+    ParseResult result;
+
+    template <bool checked> ParseStatus step(char token, int termIndex);
+    ParseStatus stop(ParseStatus status, char token, int state);
+
+public:
+    Parser(const ParseTables &t, ParseListener *l = nullptr, size_t limit = MAX_STACK);
+    void reset();
+    ParseStatus consume(char token);
+    ParseStatus feed(const char *tokens, size_t n);
+    ParseStatus finish();
+    const ParseResult &parse(const char *begin, const char *end);
+    const ParseResult &getResult() const { return result; }
+    const std::vector<int> &getStack() const { return stateStack; }
+    void restore(const std::vector<int> &states);
+};
+
+std::string describeResult(const ParseResult &result);
@@ -0,0 +1,60 @@
+#pragma once
+#include <functional>
+#include <utility>
+#include <vector>
+#include "ParseListener.h"
+#include "ParseTables.h"
+
+ /*******************************************************************************
+ * SemanticActions Class: Runs one callback per production as the parser        *
+ * reduces, yacc-style. A value stack runs parallel to the parser's state stack:*
+ * every shift pushes the token's value (from the token callback) and every     *
+ * reduce pops the values of the production body and pushes the value the       *
+ * production's action returns. Inside an action, rhs[n] is $n and the return   *
+ * value is $$. Productions without an action get yacc's default, $$ = $1 (or a *
+ * default-constructed value for an empty body). After an accept, result() is   *
+ * the value of the start symbol.                                               *
+ *******************************************************************************/
+template <typename Value>
+class SemanticActions : public ParseListener {
+public:
+    class Rhs {
+    private:
+        Value *base;
+        int length;
+    public:
+        Rhs(Value *b, int l) : base(b), length(l) {}
+        Value &operator[](int n) const { return base[n - 1]; }
+        int size() const { return length; }
+    };
+
+    typedef std::function<Value(Rhs &rhs)> Action;
+    typedef std::function<Value(char token)> TokenValue;
+
+private:
+    std::vector<Action> actions;
+    TokenValue tokenValue;
+    std::vector<Value> values;
+
+public:
+    SemanticActions(const ParseTables &tables, TokenValue tv)
+            : actions(tables.numProds), tokenValue(std::move(tv)) {}
+
+    void on(int prod, Action action) { actions[prod] = std::move(action); }
+    Value &result() { return values.back(); }
+
+    void start() override { values.clear(); }
+
+    void shift(char token) override { values.push_back(tokenValue(token)); }
+
+    void reduce(int prod, int length) override {
+        Rhs rhs(values.data() + values.size() - length, length);
+        Value value;
+        if (actions[prod]) value = actions[prod](rhs);
+        else if (length > 0) value = rhs[1];
+        else value = Value();
+
+        values.resize(values.size() - length);
+        values.push_back(std::move(value));
+    }
+};
@@ -0,0 +1,108 @@
+#include <iostream>
+#include "SentenceGenerator.h"
+
+const size_t SentenceGenerator::INFINITE;
+
+ /*******************************************************************************
+ * SentenceGenerator Class: Derives random sentences from the augmented         *
+ * grammar. Every nonterminal gets the length of its shortest derivation (and   *
+ * the production that starts it), so at any point the generator knows the      *
+ * fewest tokens the unexpanded symbols still need. A nonterminal is expanded   *
+ * by a random production that keeps the sentence within its target size;       *
+ * half the time only productions longer than the shortest are considered so    *
+ * the sentences grow towards the target. Past the maximum derivation depth,    *
+ * or when nothing fits, the shortest production is used, so every sentence     *
+ * ends. The expansion is leftmost and uses an explicit stack, so deep          *
+ * sentences cannot overflow the call stack.                                    *
+ *******************************************************************************/
+SentenceGenerator::SentenceGenerator(const Grammar &grammar, unsigned seed) : rng(seed) {
+    productions = grammar.getProductions();
+    for (size_t i = 0; i < productions.size(); i++)
+        prodsFor[productions[i].getHead()[0]].push_back((int) i);
+
+    computeMinLengths();
+    if (minLength['\''] == INFINITE) {
+        std::cerr << "The grammar derives no finite sentence" << std::endl;
+        exit(0);
+    }
+}
+
+bool SentenceGenerator::isNonTerminal(char symbol) const {
+    return prodsFor.find(symbol) != prodsFor.end();
+}
+
+size_t SentenceGenerator::symbolLength(char symbol) const {
+    return isNonTerminal(symbol) ? minLength.at(symbol) : 1;
+}
+
+// Finds the shortest derivation of each nonterminal by relaxing every
+// production until nothing changes. Nonterminals that never derive a
+// finite string keep INFINITE and are only used when unavoidable.
+void SentenceGenerator::computeMinLengths() {
+    for (auto &entry : prodsFor) minLength[entry.first] = INFINITE;
+    prodLength.assign(productions.size(), INFINITE);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < productions.size(); i++) {
+            size_t length = 0;
+            for (char symbol : productions[i].getBody()) {
+                size_t symLength = symbolLength(symbol);
+                if (symLength == INFINITE) {
+                    length = INFINITE;
+                    break;
+                }
+                length += symLength;
+            }
+
+            prodLength[i] = length;
+            char head = productions[i].getHead()[0];
+            if (length < minLength[head]) {
+                minLength[head] = length;
+                minProd[head] = (int) i;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Generates one sentence of about targetSize tokens whose derivation tree
+// is at most maxDepth deep, except where the shortest productions recurse.
+std::string SentenceGenerator::generate(size_t targetSize, size_t maxDepth) {
+    std::string sentence;
+    std::vector<Pending> stack = {{'\'', 0}};
+    size_t pending = minLength['\''];
+    std::vector<int> choices;
+
+    while (!stack.empty()) {
+        Pending current = stack.back();
+        stack.pop_back();
+        if (!isNonTerminal(current.symbol)) {
+            sentence.push_back(current.symbol);
+            pending--;
+            continue;
+        }
+
+        char symbol = current.symbol;
+        pending -= minLength[symbol];
+        bool grow = rng() % 2 == 0;
+        choices.clear();
+        if (current.depth < maxDepth) {
+            for (int prod : prodsFor[symbol]) {
+                if (prodLength[prod] == INFINITE) continue;
+                if (sentence.size() + pending + prodLength[prod] > targetSize) continue;
+                if (grow && prodLength[prod] == minLength[symbol]) continue;
+                choices.push_back(prod);
+            }
+        }
+
+        int prod = choices.empty() ? minProd[symbol] : choices[rng() % choices.size()];
+        const std::string &body = productions[prod].getBody();
+        for (size_t i = body.size(); i > 0; i--)
+            stack.push_back({body[i - 1], current.depth + 1});
+        pending += prodLength[prod];
+    }
+
+    return sentence;
+}
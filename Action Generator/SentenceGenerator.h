@@ -0,0 +1,31 @@
+#pragma once
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "Grammar.h"
+
+class SentenceGenerator {
+private:
+    struct Pending {
+        char symbol;
+        size_t depth;
+    };
+
+    std::vector<Production> productions;
+    std::map<char, std::vector<int>> prodsFor;
+    std::map<char, size_t> minLength;
+    std::map<char, int> minProd;
+    std::vector<size_t> prodLength;
+    std::mt19937 rng;
+
+    static const size_t INFINITE = (size_t) -1;
+
+    bool isNonTerminal(char symbol) const;
+    size_t symbolLength(char symbol) const;
+    void computeMinLengths();
+
+public:
+    SentenceGenerator(const Grammar &grammar, unsigned seed);
+    std::string generate(size_t targetSize, size_t maxDepth);
+};
@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "SplitParser.h"
+#include "ParseStats.h"
+
+ /*******************************************************************************
+ * SplitParser Class: Parses one large input on several threads. The input is   *
+ * cut into chunks right after synchronizing tokens: terminals that gentable    *
+ * found to always shift into the same state (sync_state). The first chunk is   *
+ * parsed for real while the others are parsed speculatively from a stack       *
+ * holding only that state. A reduce that pops below it goes on into the        *
+ * unknown stack of the chunks before: the popped entries are counted, and the  *
+ * goto pushed on top of them becomes a Symbol, standing for whichever state    *
+ * the real stack will give. Each Symbol keeps the set of states it could be,   *
+ * so the speculation can go on as long as all of them agree on the action.     *
+ * Where they do not, or where the parse fails, the speculation stops and a     *
+ * new segment of it starts after the next sync token. Then the chunks are      *
+ * stitched in order: when the real parse reaches a segment in its base state,  *
+ * its Symbols are resolved against the real stack, the recorded shifts and     *
+ * reduces are replayed to the listener, the popped entries are replaced by     *
+ * the speculative stack, and the real parse continues from where the           *
+ * speculation stopped. Otherwise (or if the stack could have overflowed) the   *
+ * segment is parsed sequentially. The result and the trace are identical to a  *
+ * sequential parse. With one thread, the input is parsed sequentially.         *
+ *******************************************************************************/
+SplitParser::SplitParser(const ParseTables &t, const std::string &syncTokens, unsigned threads,
+                         size_t minChunk, size_t limit) : tables(t) {
+    numThreads = threads > 0 ? threads : 1;
+    this->minChunk = minChunk > 0 ? minChunk : 1;
+    stackLimit = limit;
+    segmentsReused = 0;
+
+    for (bool &sync : isSync) sync = false;
+    for (char token : syncTokens) {
+        int term = tables.getTermIndex(token);
+        if (term != -1 && tables.syncState[term] != -1) isSync[(unsigned char) token] = true;
+    }
+}
+
+ /*******************************************************************************
+ * StateSets Class: The sets of states a chunk's Symbols can be, numbered in    *
+ * the chunk's sets. Set 0 holds every state, for an entry of the unknown       *
+ * stack. The action all states of a set agree on ('x' where they do not) and   *
+ * the set of their gotos are cached, as a chunk asks for the same ones over    *
+ * and over.                                                                    *
+ *******************************************************************************/
+class SplitParser::StateSets {
+private:
+    const ParseTables &tables;
+    std::vector<std::vector<int>> &sets;
+    std::map<std::vector<int>, int> ids;
+    std::vector<std::pair<char, int>> actions;     // by set and terminal, '?' until asked
+    std::vector<int> gotos;                        // by set and nonterminal, -1 until asked
+
+    int intern(const std::vector<int> &states) {
+        auto found = ids.find(states);
+        if (found != ids.end()) return found->second;
+        sets.push_back(states);
+        actions.resize(sets.size() * tables.numTerms, std::make_pair('?', 0));
+        gotos.resize(sets.size() * tables.numNonTerms, -1);
+        return ids[states] = (int) sets.size() - 1;
+    }
+
+public:
+    StateSets(const ParseTables &t, std::vector<std::vector<int>> &s) : tables(t), sets(s) {
+        std::vector<int> all(tables.numStates);
+        for (int state = 0; state < tables.numStates; state++) all[state] = state;
+        intern(all);
+    }
+
+    const std::vector<int> &get(int set) const { return sets[set]; }
+
+    std::pair<char, int> action(int set, int term) {
+        std::pair<char, int> &cached = actions[set * tables.numTerms + term];
+        if (cached.first != '?') return cached;
+
+        const std::vector<int> &states = sets[set];
+        std::pair<char, int> agreed(tables.getAction(states[0], term), tables.getActionNum(states[0], term));
+        for (int state : states) {
+            if (tables.getAction(state, term) != agreed.first || tables.getActionNum(state, term) != agreed.second) {
+                agreed = std::make_pair('x', 0);
+                break;
+            }
+        }
+        return cached = agreed;
+    }
+
+    int goTo(int set, int lhs) {
+        if (gotos[set * tables.numNonTerms + lhs] != -1) return gotos[set * tables.numNonTerms + lhs];
+
+        std::vector<int> targets;
+        for (int state : sets[set]) {
+            int target = tables.getGoto(state, lhs);
+            if (target != 0) targets.push_back(target);
+        }
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        int targetSet = intern(targets);
+        return gotos[set * tables.numNonTerms + lhs] = targetSet;
+    }
+};
+
+bool SplitParser::hasSyncTokens() const {
+    for (bool sync : isSync)
+        if (sync) return true;
+    return false;
+}
+
+ParseResult SplitParser::parse(const char *begin, const char *end, ParseListener *listener) {
+    const char *dollar = static_cast<const char *>(memchr(begin, '$', end - begin));
+    if (dollar != nullptr) end = dollar;
+
+    std::vector<Chunk> chunks = split(begin, end);
+    std::vector<char> done(chunks.size(), 0);
+    std::mutex lock;
+    std::condition_variable finished;
+    std::atomic<size_t> next(1);
+    auto speculateNext = [&]() {
+        size_t i = next.fetch_add(1);
+        if (i >= chunks.size()) return false;
+        speculate(chunks[i]);
+        std::lock_guard<std::mutex> guard(lock);
+        done[i] = 1;
+        finished.notify_all();
+        return true;
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < numThreads && i < chunks.size(); i++)
+        workers.emplace_back([&]() { while (speculateNext()); });
+
+    Parser parser(tables, listener, stackLimit);
+    parser.feed(chunks[0].begin, chunks[0].end - chunks[0].begin);
+
+    // Each chunk is stitched as soon as it is speculated, while the workers
+    // go on with the later ones. One that nobody has taken yet is speculated
+    // here rather than waited for.
+    segmentsReused = 0;
+    for (size_t i = 1; i < chunks.size() && parser.getResult().status == ParseStatus::NEED_MORE; i++) {
+        while (next.load() <= i && speculateNext());
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            finished.wait(guard, [&]() { return done[i] != 0; });
+        }
+
+        Chunk &chunk = chunks[i];
+        const char *fed = chunk.begin;
+        for (Segment &segment : chunk.segments) {
+            if (parser.feed(fed, segment.begin - fed) != ParseStatus::NEED_MORE) break;
+
+            std::vector<int> stack = parser.getStack();
+            if (!resolve(segment, chunk, stack)) {
+                fed = segment.begin;
+                continue;
+            }
+            replay(segment.events, listener);
+            PARSE_STATS(merge(segment.stats));
+            PARSE_STATS(depth(parser.getStack().size() - 1 + (size_t) segment.peak));
+            parser.restore(stack);
+            fed = segment.stop;
+            segmentsReused++;
+        }
+        parser.feed(fed, chunk.end - fed);
+        chunk.segments.clear();
+    }
+    // once the parse has failed, the chunks left are not needed
+    next.store(chunks.size());
+    for (auto &worker : workers) worker.join();
+
+    parser.finish();
+    return parser.getResult();
+}
+
+// Cuts the input into about four chunks per thread, each ending right after a
+// sync token. A chunk is never smaller than minChunk bytes. With one thread
+// there is nobody to speculate, so the input stays whole.
+std::vector<SplitParser::Chunk> SplitParser::split(const char *begin, const char *end) const {
+    size_t target = std::max(minChunk, (size_t) (end - begin) / (numThreads * 4) + 1);
+    if (numThreads == 1) target = (size_t) (end - begin);
+    std::vector<Chunk> chunks;
+    const char *start = begin;
+    int baseState = -1;
+    while (true) {
+        const char *cut = end;
+        if ((size_t) (end - start) > target) {
+            for (cut = start + target; cut != end && !isSync[(unsigned char) *cut]; cut++);
+        }
+
+        Chunk chunk;
+        chunk.begin = start;
+        chunk.end = cut == end ? end : cut + 1;
+        chunk.baseState = baseState;
+        chunks.push_back(std::move(chunk));
+        if (cut == end) break;
+
+        baseState = tables.syncState[tables.getTermIndex(*cut)];
+        start = cut + 1;
+    }
+
+    return chunks;
+}
+
+// Speculates a chunk one segment at a time. After a segment stops where the
+// real stack decides the action, the next one starts behind the following sync
+// token; the real parse covers the gap. Where the real parse must fail, the
+// rest of the chunk is left to it.
+void SplitParser::speculate(Chunk &chunk) const {
+    StateSets states(tables, chunk.sets);
+    const char *start = chunk.begin;
+    int baseState = chunk.baseState;
+    while (start != chunk.end) {
+        Segment segment;
+        segment.begin = start;
+        segment.baseState = baseState;
+        bool more = speculate(segment, chunk.end, states);
+        const char *stop = segment.stop;
+        if (stop != chunk.end) segment.events.shrink_to_fit();
+        chunk.segments.push_back(std::move(segment));
+        if (!more) break;
+
+        while (stop != chunk.end && !isSync[(unsigned char) *stop]) stop++;
+        if (stop == chunk.end) break;
+        baseState = tables.syncState[tables.getTermIndex(*stop)];
+        start = stop + 1;
+    }
+}
+
+ /*******************************************************************************
+ * speculate: Parses a segment starting from a stack with only its base state.  *
+ * The recorded events are reductions (production numbers) and shifts (the      *
+ * complement of the token). segment.stop is where the real parse has to take   *
+ * over. A goto on top of the unknown stack, or on top of a Symbol, pushes a    *
+ * new Symbol unless all the states it could come from agree on the target.     *
+ * Returns false when the real parse cannot get past the stop: a bad token, an  *
+ * error in every state the stack can be in, or a speculative stack that alone  *
+ * reaches the stack limit (the segment is then given up and will be parsed     *
+ * sequentially, to overflow there). In a cparse-stats build, a token is only   *
+ * counted once it is shifted, and one the speculation stops inside is taken    *
+ * back whole, so the segment's counters hold just the work parse() keeps; the  *
+ * visits to Symbols are counted once they are resolved.                        *
+ *******************************************************************************/
+bool SplitParser::speculate(Segment &segment, const char *end, StateSets &states) const {
+    segment.stack.assign(1, segment.baseState);
+    segment.stop = end;
+    // about the most events a token can bring in a typical grammar, for each byte
+    segment.events.reserve((end - segment.begin) * 2);
+    segment.popped = 0;
+    segment.peak = 1;
+#ifdef CPARSE_STATS
+    std::vector<int> tokenStack, tokenVisits;
+#endif
+    auto giveUp = [&]() {
+        segment.stack.assign(1, segment.baseState);
+        segment.symbols.clear();
+        segment.events.clear();
+        segment.stop = segment.begin;
+        segment.popped = 0;
+        segment.peak = 1;
+#ifdef CPARSE_STATS
+        segment.stats = ParseStats();
+#endif
+    };
+
+    for (const char *ptr = segment.begin; ptr != end; ptr++) {
+        if (isspace((unsigned char) *ptr)) continue;
+
+        int term = tables.getTermIndex(*ptr);
+        if (term == -1) {
+            segment.stop = ptr;
+            return false;
+        }
+
+        int top = segment.stack.back();
+        std::pair<char, int> action = top >= 0
+            ? std::make_pair(tables.getAction(top, term), tables.getActionNum(top, term))
+            : states.action(segment.symbols[~top].set, term);
+        size_t chain = 0;
+#ifdef CPARSE_STATS
+        size_t tokenEvents = segment.events.size();
+        size_t tokenSymbols = segment.symbols.size();
+        size_t tokenPopped = segment.popped;
+        tokenStack = segment.stack;
+        tokenVisits.clear();
+#endif
+        while (action.first == 'r') {
+            size_t length = tables.reduceNum[action.second];
+            int lhs = tables.reduceLHS[action.second];
+#ifdef CPARSE_STATS
+            tokenVisits.push_back(top);
+#endif
+            segment.events.push_back(action.second);
+            chain++;
+
+            int below;
+            if (length < segment.stack.size()) {
+                segment.stack.resize(segment.stack.size() - length);
+                below = segment.stack.back();
+            } else {
+                segment.popped += length - segment.stack.size();
+                segment.stack.clear();
+                below = (int) segment.popped;
+            }
+
+            if (below >= 0 && !segment.stack.empty()) {
+                segment.stack.push_back(tables.getGoto(below, lhs));
+            } else {
+                int set = states.goTo(below >= 0 ? 0 : segment.symbols[~below].set, lhs);
+                const std::vector<int> &targets = states.get(set);
+                if (targets.empty()) {
+                    // no real stack gets here, so the real parse fails before
+                    giveUp();
+                    return false;
+                }
+                if (targets.size() == 1) {
+                    segment.stack.push_back(targets[0]);
+                } else if (!segment.symbols.empty() && segment.symbols.back().below == below &&
+                           segment.symbols.back().lhs == lhs) {
+                    // the same goto from the same entry: a list reduced again and again
+                    segment.stack.push_back(~(int) (segment.symbols.size() - 1));
+                } else {
+                    Symbol symbol;
+                    symbol.below = below;
+                    symbol.lhs = lhs;
+                    symbol.set = set;
+#ifdef CPARSE_STATS
+                    symbol.visits = 0;
+#endif
+                    segment.symbols.push_back(symbol);
+                    segment.stack.push_back(~(int) (segment.symbols.size() - 1));
+                }
+            }
+            segment.peak = std::max(segment.peak, (long) segment.stack.size() - (long) segment.popped);
+            if (segment.stack.size() >= stackLimit) {
+                giveUp();
+                return false;
+            }
+
+            top = segment.stack.back();
+            action = top >= 0
+                ? std::make_pair(tables.getAction(top, term), tables.getActionNum(top, term))
+                : states.action(segment.symbols[~top].set, term);
+        }
+
+        if (action.first != 's') {
+#ifdef CPARSE_STATS
+            // the real parse takes the whole token over, so its reductions are counted there
+            segment.stack.swap(tokenStack);
+            segment.symbols.resize(tokenSymbols);
+            segment.popped = tokenPopped;
+            segment.events.resize(tokenEvents);
+#endif
+            segment.stop = ptr;
+            return action.first == 'x';
+        }
+
+#ifdef CPARSE_STATS
+        tokenVisits.push_back(top);
+        for (size_t i = 0; i < tokenVisits.size(); i++) {
+            if (tokenVisits[i] >= 0) segment.stats.visit(tokenVisits[i]);
+            else segment.symbols[~tokenVisits[i]].visits++;
+            if (i < chain) segment.stats.reduce(segment.events[tokenEvents + i]);
+        }
+        segment.stats.chain(chain);
+        segment.stats.shift(term);
+#endif
+        segment.stack.push_back(action.second);
+        segment.events.push_back(~(int) (unsigned char) *ptr);
+        segment.peak = std::max(segment.peak, (long) segment.stack.size() - (long) segment.popped);
+        if (segment.stack.size() >= stackLimit) {
+            giveUp();
+            return false;
+        }
+    }
+    return true;
+}
+
+ /*******************************************************************************
+ * resolve: Checks a segment against the real stack the parse has reached and   *
+ * builds the stack the parse continues with: the real stack less the popped    *
+ * entries, then the speculative stack with every Symbol replaced by the goto   *
+ * from the state under it. The segment cannot be used when the real stack      *
+ * does not end in its base state, is too short for what it popped, could       *
+ * overflow on the way, or gives a Symbol a state outside its set.              *
+ *******************************************************************************/
+bool SplitParser::resolve(const Segment &segment, const Chunk &chunk, std::vector<int> &stack) const {
+    size_t size = stack.size();
+    if (stack.back() != segment.baseState || segment.popped + 2 > size) return false;
+    if ((long) size - 1 + segment.peak >= (long) stackLimit) return false;
+
+    std::vector<int> states(segment.symbols.size());
+    for (size_t i = 0; i < segment.symbols.size(); i++) {
+        const Symbol &symbol = segment.symbols[i];
+        int below = symbol.below >= 0 ? stack[size - 2 - symbol.below] : states[~symbol.below];
+        states[i] = tables.getGoto(below, symbol.lhs);
+        const std::vector<int> &set = chunk.sets[symbol.set];
+        if (!std::binary_search(set.begin(), set.end(), states[i])) return false;
+    }
+
+    stack.resize(size - 1 - segment.popped);
+    for (int entry : segment.stack) stack.push_back(entry >= 0 ? entry : states[~entry]);
+#ifdef CPARSE_STATS
+    for (size_t i = 0; i < segment.symbols.size(); i++)
+        for (unsigned long visit = 0; visit < segment.symbols[i].visits; visit++) PARSE_STATS(visit(states[i]));
+#endif
+    return true;
+}
+
+void SplitParser::replay(const std::vector<int> &events, ParseListener *listener) const {
+    if (listener == nullptr) return;
+    for (int event : events) {
+        if (event >= 0) listener->reduce(event, tables.reduceNum[event]);
+        else listener->shift((char) ~event);
+    }
+}
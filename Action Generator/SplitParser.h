@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Parser.h"
+#include "ParseStats.h"
+
+class SplitParser {
+private:
+    // A stack entry whose state depends on the stack below the speculation:
+    // the goto on lhs from the entry below, which is another Symbol (~index)
+    // or, when below >= 0, the state that many entries under the popped prefix
+    struct Symbol {
+        int below;
+        int lhs;
+        int set;                    // index of the states it can be
+#ifdef CPARSE_STATS
+        unsigned long visits;
+#endif
+    };
+
+    struct Segment {
+        const char *begin, *stop;
+        int baseState;
+        size_t popped;              // entries of the real stack the speculation reduced away
+        long peak;                  // the most the stack grew above the real stack's base
+        std::vector<int> stack;     // states, or ~index of a Symbol
+        std::vector<Symbol> symbols;
+        std::vector<int> events;
+#ifdef CPARSE_STATS
+        ParseStats stats;           // the speculation's counters, merged if the segment is reused
+#endif
+    };
+
+    struct Chunk {
+        const char *begin, *end;
+        int baseState;
+        std::vector<Segment> segments;
+        std::vector<std::vector<int>> sets;
+    };
+
+    class StateSets;
+
+    const ParseTables &tables;
+    unsigned numThreads;
+    size_t minChunk;
+    size_t stackLimit;
+    bool isSync[256];
+    size_t segmentsReused;
+
+    std::vector<Chunk> split(const char *begin, const char *end) const;
+    void speculate(Chunk &chunk) const;
+    bool speculate(Segment &segment, const char *end, StateSets &states) const;
+    bool resolve(const Segment &segment, const Chunk &chunk, std::vector<int> &stack) const;
+    void replay(const std::vector<int> &events, ParseListener *listener) const;
+
+public:
+    SplitParser(const ParseTables &t, const std::string &syncTokens, unsigned threads,
+                size_t minChunk = 1 << 20, size_t limit = MAX_STACK);
+    bool hasSyncTokens() const;
+    ParseResult parse(const char *begin, const char *end, ParseListener *listener);
+    size_t getSegmentsReused() const { return segmentsReused; }
+};
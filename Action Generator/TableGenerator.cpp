@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include "TableGenerator.h"
@@ -19,12 +20,26 @@ TableGenerator::TableGenerator(size_t numS, size_t numT, size_t numNT, size_t nu
     numTerms = numT;
     numNonTerms = numNT;
     numProds = numP;
+    maxDepth = 0;
 
     initVectors();
 }
 
+// Sets the per-state visit counts (indexed by LR(0) set number) that the
+// states are renumbered by. Without a profile, the set numbers are kept.
+void TableGenerator::setProfile(const std::vector<unsigned long> &visits) {
+    if (visits.size() != numStates) {
+        std::cerr << "Profile has " << visits.size() << " states, expected " << numStates << std::endl;
+        exit(0);
+    }
+
+    profile = visits;
+}
+
 void TableGenerator::generateTable(const Grammar &grammar, const Follows &follows, const LRSet &lrSet) {
     createTable(grammar, follows, lrSet);
+    computeMaxDepth(lrSet);
+    if (!profile.empty()) renumberStates();
     std::ofstream tables("./tables.h");
 
     std::string definitions = generateDefinitions();
@@ -47,6 +62,14 @@ void TableGenerator::generateTable(const Grammar &grammar, const Follows &follow
     std::cout << tokenArrString;
     tables << tokenArrString;
 
+    std::string syncStateString = generateSyncStates();
+    std::cout << syncStateString;
+    tables << syncStateString;
+
+    std::string origStateString = generateOrigStates();
+    std::cout << origStateString;
+    tables << origStateString;
+
 }
 
 std::string TableGenerator::generateTokenArr(const Grammar &grammar)  {
@@ -110,6 +133,130 @@ std::string TableGenerator::generateReduceNum(const Grammar &grammar) {
     return result;
 }
 
+// For each terminal, the one state every shift of it leads to, or -1 if
+// shifts of the terminal lead to different states (or it's never shifted).
+// The parser can start a chunk of input that follows such a token in its
+// sync state without knowing anything about what came before it.
+std::string TableGenerator::generateSyncStates() {
+    std::string result = "static int sync_state[NUM_TERMS] =\n /*";
+    for (int i = 0; i < numTerms; i++) {
+        if (i == 0) result.append("   ");
+        else result.append("    ");
+        result.append(std::to_string(i));
+    }
+
+    result.append("  */\n   {");
+    for (int i = 0; i < numTerms; i++) {
+        result.append(" " + std::to_string(syncState[i]));
+        if (i != numTerms - 1) result.append(",");
+    }
+
+    result.append(" };\n\n");
+    return result;
+}
+
+// For each state, the number of the LR(0) set it was built from. Parsers
+// report states by these numbers, so renumbering never shows in the output.
+std::string TableGenerator::generateOrigStates() {
+    std::string result = "static int orig_state[NUM_STATES] =\n   {";
+    for (int i = 0; i < numStates; i++) {
+        result.append(" " + std::to_string(origState[i]));
+        if (i != numStates - 1) result.append(",");
+    }
+
+    result.append(" };\n\n");
+    return result;
+}
+
+ /*******************************************************************************
+ * renumberStates(): Reorders the states by the profile so the hottest rows of  *
+ * action, action_num and go_to sit next to each other. State 0 is the start    *
+ * state (and the 0 of an empty go_to cell), so it stays first; the others      *
+ * follow by visit count, with ties and unvisited states in their old order.    *
+ * Shift targets, go_to entries and sync states are mapped to the new numbers.  *
+ *******************************************************************************/
+void TableGenerator::renumberStates() {
+    std::vector<int> order;
+    for (int state = 1; state < numStates; state++) order.push_back(state);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return profile[a] > profile[b];
+    });
+    order.insert(order.begin(), 0);
+
+    std::vector<int> newNum(numStates);
+    for (int i = 0; i < numStates; i++) newNum[order[i]] = i;
+
+    std::vector<std::vector<char>> newAction;
+    std::vector<std::vector<int>> newActionNum, newGoto;
+    for (int i = 0; i < numStates; i++) {
+        int old = order[i];
+        newAction.push_back(action[old]);
+        newActionNum.push_back(actionNum[old]);
+        newGoto.push_back(gotoArr[old]);
+
+        for (int col = 0; col < numTerms; col++) {
+            if (newAction[i][col] == 's') newActionNum[i][col] = newNum[newActionNum[i][col]];
+        }
+        for (int col = 0; col < numNonTerms; col++) {
+            newGoto[i][col] = newNum[newGoto[i][col]];
+        }
+        origState[i] = old;
+    }
+
+    action = newAction;
+    actionNum = newActionNum;
+    gotoArr = newGoto;
+    for (int term = 0; term < numTerms; term++) {
+        if (syncState[term] != -1) syncState[term] = newNum[syncState[term]];
+    }
+}
+
+ /*******************************************************************************
+ * computeMaxDepth(): Every stack the parser can build spells a path of shifts  *
+ * and gotos from state 0, one state per step. If the goto graph has no cycle   *
+ * the longest such path bounds the stack, and its length (counting state 0)    *
+ * becomes MAX_STACK_DEPTH. A cycle means the depth is unbounded; maxDepth then *
+ * stays 0 and no bound is emitted.                                             *
+ *******************************************************************************/
+void TableGenerator::computeMaxDepth(const LRSet &lrSet) {
+    const std::vector<State> &states = lrSet.getStates();
+    // 0: unvisited, 1: on the current path, 2: done (longest[] is known)
+    std::vector<int> mark(numStates, 0);
+    std::vector<size_t> longest(numStates, 1);
+    std::vector<std::pair<int, std::map<char, int>::const_iterator>> path;
+
+    mark[0] = 1;
+    path.push_back({0, states[0].getGotoMap().begin()});
+    while (!path.empty()) {
+        int state = path.back().first;
+        auto &next = path.back().second;
+        if (next == states[state].getGotoMap().end()) {
+            mark[state] = 2;
+            path.pop_back();
+            if (!path.empty()) {
+                int parent = path.back().first;
+                longest[parent] = std::max(longest[parent], longest[state] + 1);
+            }
+            continue;
+        }
+
+        int target = (next++)->second;
+        if (mark[target] == 1) {
+            maxDepth = 0;
+            return;
+        }
+        if (mark[target] == 2) {
+            longest[state] = std::max(longest[state], longest[target] + 1);
+            continue;
+        }
+
+        mark[target] = 1;
+        path.push_back({target, states[target].getGotoMap().begin()});
+    }
+
+    maxDepth = longest[0];
+}
+
 void TableGenerator::initVectors() {
     // Initialize action array
     for (int row = 0; row < numStates; row++) {
@@ -137,6 +284,12 @@ void TableGenerator::initVectors() {
         }
         gotoArr.push_back(vec);
     }
+
+    // No terminal has a sync state until a shift on it is found
+    syncState.assign(numTerms, -1);
+
+    // Each state starts out as its own LR(0) set
+    for (int state = 0; state < numStates; state++) origState.push_back(state);
 }
 
 void TableGenerator::createTable(const Grammar &grammar, const Follows &follows, const LRSet &lrSet)  {
@@ -173,12 +326,14 @@ void TableGenerator::createTable(const Grammar &grammar, const Follows &follows,
     }
 
     stateNum = 0;
+    std::vector<std::set<int>> shiftTargets(numTerms);
     for (auto& state : lrSet.getStates()) {
         for (auto const &pair: state.getGotoMap()) {
             if (grammar.isTerminal(pair.first)) {
                 int termIndex = grammar.getTerminalIndex(pair.first);
                 action[stateNum][termIndex] = 's';
                 actionNum[stateNum][termIndex] = pair.second;
+                shiftTargets[termIndex].insert(pair.second);
             } else if (follows.isNonTerminal(pair.first)) {
                 int nonTermIndex = follows.getNonTerminalIndex(pair.first);
                 gotoArr[stateNum][nonTermIndex] = pair.second;
@@ -191,6 +346,9 @@ void TableGenerator::createTable(const Grammar &grammar, const Follows &follows,
         stateNum++;
     }
 
+    for (int term = 0; term < numTerms; term++) {
+        if (shiftTargets[term].size() == 1) syncState[term] = *shiftTargets[term].begin();
+    }
 }
 
 std::string TableGenerator::generateTableString(const Grammar &grammar, const Follows &follows) {
@@ -305,7 +463,9 @@ std::string TableGenerator::generateDefinitions() {
     result.append("#define NUM_STATES   " + std::to_string(numStates) + "\n");
     result.append("#define NUM_TERMS    " + std::to_string(numTerms) + "\n");
     result.append("#define NUM_NONTERMS " + std::to_string(numNonTerms) + "\n");
-    result.append("#define NUM_PRODS    " + std::to_string(numProds) + "\n\n");
+    result.append("#define NUM_PRODS    " + std::to_string(numProds) + "\n");
+    if (maxDepth != 0) result.append("#define MAX_STACK_DEPTH " + std::to_string(maxDepth) + "\n");
+    result.append("\n");
     return result;
 }
 
@@ -9,9 +9,17 @@ private:
     std::vector<std::vector<int>> actionNum, gotoArr;
     std::vector<int> reduceLHS;
     std::vector<size_t> reduceNum;
+    std::vector<int> syncState;
+    std::vector<int> origState;
+    std::vector<unsigned long> profile;
+    size_t maxDepth;
 
     void initVectors();
     std::string generateTokenArr(const Grammar& grammar);
+    std::string generateSyncStates();
+    std::string generateOrigStates();
+    void renumberStates();
+    void computeMaxDepth(const LRSet& lrSet);
     std::string generateReduceLHS(const Grammar& grammar, const Follows& follows);
     std::string generateReduceNum(const Grammar& grammar);
     std::string generateTableString(const Grammar& grammar, const Follows& follows);
@@ -19,6 +27,8 @@ private:
     void createTable(const Grammar& grammar, const Follows& follows, const LRSet& lrSet);
 public:
     TableGenerator(size_t numS, size_t numT, size_t numNT, size_t numP);
+    void setProfile(const std::vector<unsigned long>& visits);
+    size_t getMaxDepth() const { return maxDepth; }
     void generateTable(const Grammar& grammar, const Follows& follows, const LRSet& lrSet);
 };
 
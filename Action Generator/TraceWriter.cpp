@@ -0,0 +1,129 @@
+#include "TraceWriter.h"
+
+ /*******************************************************************************
+ * TraceWriter Class: Collects the reductions made by the parser and writes     *
+ * them out in one of four formats. Output is staged in a large buffer and only *
+ * handed to the FILE when the buffer fills or the trace is finished, so there  *
+ * is no per-line flush or string allocation.                                   *
+ *   TEXT:   "reduce N" lines, identical to the original cparse output.         *
+ *   BINARY: "CPT" magic, a version byte and a flags byte, then one varint      *
+ *           (LEB128) per reduction holding production + 1.                     *
+ *   RLE:    same header with flag bit 0 set; each record is varint(prod + 1)   *
+ *           followed by varint(run length).                                    *
+ *   COUNT:  nothing per reduction; a per-production summary is written when    *
+ *           the trace is finished.                                             *
+ * Binary traces end with a 0 varint followed by the status byte ('a' accept,   *
+ * 'e' error, 'o' stack overflow).                                              *
+ *******************************************************************************/
+TraceWriter::TraceWriter(std::FILE *o, TraceFormat f, size_t numProds) {
+    out = o;
+    format = f;
+    buffer.resize(BUFFER_SIZE);
+    used = 0;
+    runProd = -1;
+    runLength = 0;
+    total = 0;
+    counts.resize(numProds, 0);
+
+    if (format == TraceFormat::BINARY || format == TraceFormat::RLE) {
+        putString("CPT");
+        put(1);
+        put(format == TraceFormat::RLE ? 1 : 0);
+    }
+}
+
+TraceWriter::~TraceWriter() {
+    flush();
+}
+
+void TraceWriter::reduce(int prod, int) {
+    total++;
+    switch (format) {
+        case TraceFormat::TEXT:
+            putString("reduce ");
+            putNumber(prod);
+            put('\n');
+            break;
+        case TraceFormat::BINARY:
+            putVarint(prod + 1);
+            break;
+        case TraceFormat::RLE:
+            if (prod != runProd) {
+                endRun();
+                runProd = prod;
+            }
+            runLength++;
+            break;
+        case TraceFormat::COUNT:
+            counts[prod]++;
+            break;
+    }
+}
+
+// Ends the trace. Binary formats get their terminator record; the count
+// format writes its summary. Text traces need nothing extra.
+void TraceWriter::finish(char status) {
+    if (format == TraceFormat::RLE) endRun();
+
+    if (format == TraceFormat::BINARY || format == TraceFormat::RLE) {
+        putVarint(0);
+        put(status);
+    } else if (format == TraceFormat::COUNT) {
+        putString("reductions ");
+        putNumber(total);
+        put('\n');
+        for (size_t prod = 0; prod < counts.size(); prod++) {
+            if (counts[prod] == 0) continue;
+            putString("reduce ");
+            putNumber(prod);
+            putString(": ");
+            putNumber(counts[prod]);
+            put('\n');
+        }
+    }
+
+    flush();
+}
+
+void TraceWriter::flush() {
+    if (used == 0) return;
+    std::fwrite(buffer.data(), 1, used, out);
+    std::fflush(out);
+    used = 0;
+}
+
+void TraceWriter::put(char c) {
+    if (used == buffer.size()) flush();
+    buffer[used++] = c;
+}
+
+void TraceWriter::putVarint(unsigned long value) {
+    while (value >= 0x80) {
+        put((char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    put((char) value);
+}
+
+// Writes the decimal digits of value without going through std::to_string
+void TraceWriter::putNumber(unsigned long value) {
+    char digits[24];
+    int len = 0;
+    do {
+        digits[len++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (len > 0) put(digits[--len]);
+}
+
+void TraceWriter::putString(const char *str) {
+    while (*str) put(*str++);
+}
+
+void TraceWriter::endRun() {
+    if (runLength == 0) return;
+    putVarint(runProd + 1);
+    putVarint(runLength);
+    runLength = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+#include "ParseListener.h"
+
+enum class TraceFormat { TEXT, BINARY, RLE, COUNT };
+
+class TraceWriter : public ParseListener {
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    std::FILE *out;
+    TraceFormat format;
+    std::vector<char> buffer;
+    size_t used;
+    int runProd;
+    unsigned long runLength;
+    unsigned long total;
+    std::vector<unsigned long> counts;
+
+    void put(char c);
+    void putVarint(unsigned long value);
+    void putNumber(unsigned long value);
+    void putString(const char *str);
+    void endRun();
+
+public:
+    TraceWriter(std::FILE *o, TraceFormat f, size_t numProds);
+    ~TraceWriter();
+    TraceFormat getFormat() const { return format; }
+    void reduce(int prod, int length = 0) override;
+    void finish(char status);
+    void flush();
+};
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "Parser.h"
+#include "SplitParser.h"
+
+ /*******************************************************************************
+ * CountingListener: Counts shifted tokens and reductions and follows the       *
+ * stack depth (a shift pushes one state; a reduce pops the body and pushes     *
+ * the goto state) to find the deepest the stack got.                           *
+ *******************************************************************************/
+class CountingListener : public ParseListener {
+public:
+    unsigned long tokens = 0, reductions = 0;
+    size_t depth = 1, peakDepth = 1;
+
+    void start() override { depth = 1; }
+    void shift(char) override {
+        tokens++;
+        depth++;
+        peakDepth = std::max(peakDepth, depth);
+    }
+    void reduce(int, int length) override {
+        reductions++;
+        depth = depth - length + 1;
+        peakDepth = std::max(peakDepth, depth);
+    }
+};
+
+ /*******************************************************************************
+ * main: Benchmarks the table-driven parser on a file of sentences, one per     *
+ * line (as written by gensent), or on standard-in. A first pass with a         *
+ * CountingListener gets the tokens, reductions and peak stack depth; then the  *
+ * sentences are parsed -r times (default 5) without a listener and the best    *
+ * time is used for the rates. With -s, the input is one large sentence         *
+ * instead, timed with a plain Parser and with a SplitParser cutting it after   *
+ * the given sync tokens for -j threads (see benchSplit).                       *
+ *******************************************************************************/
+int benchSplit(const std::string &input, const char *syncTokens, unsigned threads, int runs);
+
+int main(int argc, char *argv[]) {
+    int runs = 5;
+    const char *syncTokens = nullptr;
+    unsigned threads = std::thread::hardware_concurrency();
+    int opt;
+    while ((opt = getopt(argc, argv, "r:s:j:")) != -1) {
+        if (opt == 'r') {
+            runs = std::max(1, atoi(optarg));
+        } else if (opt == 's') {
+            syncTokens = optarg;
+        } else if (opt == 'j') {
+            threads = (unsigned) atoi(optarg);
+        } else {
+            std::cerr << "Usage: cbench [-r runs] [file]\n"
+                      << "       cbench -s tokens [-j threads] [-r runs] [file]" << std::endl;
+            exit(0);
+        }
+    }
+
+    std::ostringstream contents;
+    if (optind < argc) {
+        std::ifstream file(argv[optind], std::ios::binary);
+        if (!file) {
+            std::cerr << "Could not open " << argv[optind] << std::endl;
+            exit(0);
+        }
+        contents << file.rdbuf();
+    } else {
+        contents << std::cin.rdbuf();
+    }
+
+    std::string input = contents.str();
+    if (syncTokens != nullptr) return benchSplit(input, syncTokens, threads, runs);
+
+    std::vector<std::pair<const char *, const char *>> sentences;
+    for (size_t start = 0; start < input.size(); ) {
+        size_t end = input.find('\n', start);
+        if (end == std::string::npos) end = input.size();
+        if (end > start) sentences.push_back({input.data() + start, input.data() + end});
+        start = end + 1;
+    }
+
+    const ParseTables &tables = getParseTables();
+    CountingListener counts;
+    Parser counter(tables, &counts);
+    unsigned long errors = 0;
+    for (auto &sentence : sentences) {
+        if (counter.parse(sentence.first, sentence.second).status != ParseStatus::ACCEPT) errors++;
+    }
+
+    Parser parser(tables);
+    double best = 0;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (auto &sentence : sentences) parser.parse(sentence.first, sentence.second);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (run == 0 || seconds.count() < best) best = seconds.count();
+    }
+
+    std::printf("cparse: %zu sentences, %lu errors, %lu tokens, %lu reductions, peak depth %zu\n",
+                sentences.size(), errors, counts.tokens, counts.reductions, counts.peakDepth);
+    std::printf("cparse: %.3f s, %.0f tokens/sec, %.0f reductions/sec\n",
+                best, counts.tokens / best, counts.reductions / best);
+    return 0;
+}
+
+ /*******************************************************************************
+ * benchSplit: Times one large input parsed by a single Parser, as cparse does  *
+ * by default, and by a SplitParser, as cparse -s does. Both tell the same      *
+ * CountingListener about every shift and reduce, so the split time includes    *
+ * replaying the speculated chunks. The best of -r runs is used for each.       *
+ *******************************************************************************/
+int benchSplit(const std::string &input, const char *syncTokens, unsigned threads, int runs) {
+    const ParseTables &tables = getParseTables();
+    SplitParser splitParser(tables, syncTokens, threads);
+    if (!splitParser.hasSyncTokens()) {
+        std::cerr << "No usable sync tokens in: " << syncTokens << std::endl;
+        exit(0);
+    }
+
+    const char *begin = input.data(), *end = input.data() + input.size();
+    CountingListener counts;
+    ParseStatus single = ParseStatus::NEED_MORE, split = ParseStatus::NEED_MORE;
+    double singleBest = 0, splitBest = 0;
+    for (int run = 0; run < runs; run++) {
+        Parser parser(tables, &counts);
+        auto start = std::chrono::steady_clock::now();
+        single = parser.parse(begin, end).status;
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (run == 0 || seconds.count() < singleBest) singleBest = seconds.count();
+
+        start = std::chrono::steady_clock::now();
+        split = splitParser.parse(begin, end, &counts).status;
+        seconds = std::chrono::steady_clock::now() - start;
+        if (run == 0 || seconds.count() < splitBest) splitBest = seconds.count();
+    }
+
+    std::printf("cparse: 1 sentence of %zu bytes, %s, %lu tokens, %lu reductions, peak depth %zu\n",
+                input.size(), describeResult({single, '\0', 0}).c_str(), counts.tokens / (2 * runs),
+                counts.reductions / (2 * runs), counts.peakDepth);
+    std::printf("cparse: %.3f s on one parser\n", singleBest);
+    std::printf("cparse: %.3f s split on %u threads, %zu segments reused, %.2fx%s\n", splitBest, threads,
+                splitParser.getSegmentsReused(), singleBest / splitBest,
+                split == single ? "" : " (the results differ)");
+    return 0;
+}
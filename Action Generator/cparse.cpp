@@ -1,152 +1,266 @@
 #include <iostream>
-#include <vector>
-#include <stack>
-#include <map>
-#include "tables.h"
+#include <fstream>
+#include <cstring>
+#include <cctype>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "BatchParser.h"
+#include "ParseStats.h"
+#include "ParseTree.h"
+#include "SplitParser.h"
+#include "TraceWriter.h"
 
 
-std::map<char, int> getTerminalMap();
-bool isBadToken(char token);
+TraceFormat getTraceFormat(const char *name);
+int parseSingle(const ParseTables &tables, TraceWriter &trace, bool printTree);
+int parseSplit(const ParseTables &tables, TraceWriter &trace, bool printTree, const char *syncTokens,
+               unsigned threads, const char *fileName);
+int reportResult(const ParseResult &result, TraceWriter &trace, ParseTree &tree, bool printTree);
+int parseBatch(const ParseTables &tables, int argc, char *argv[], char delimiter,
+               unsigned threads, size_t lanes);
+void writeStatus(TraceWriter &trace, const std::string &message);
+void writeStats(const ParseTables &tables);
+
+static const char *statsName = nullptr;
 
  /*******************************************************************************
- * main: This is the function that acts as the main while-loop that collects    *
- * the input from standard-in and parses it. To start the algorithm, a '0' is   *
- * added to the state stack, signifying the start state. Characters (excluding  *
- * white spaces) are read into the currentLetter. The currentLetter acts as the *
- * top of the character stack, so there is no need for two stacks or one comb-  *
- * ined stack. Each letter is tested against the action array. If it's an 'r',  *
- * then the stack must be continuously reduced until another action is avail-   *
- * able. After the reduce, depending on the state number and the current token, *
- * it is decided ifi 'ts an error or an accept state. If neither, then shift    *
- * the new state onto the stack. After the input is finished, there can still   *
- * be a full state stack. The parser must continue until the stack is empty     *
- * by reducing the remainder; it no longer shifts because there isn't any input.*
+ * main: Reads the options and hands the input to one of the two modes. By      *
+ * default cparse parses a single input from standard-in and traces each reduce *
+ * through a TraceWriter; -f picks its format and -o its file, while -T prints  *
+ * the parse tree instead of the trace. With -b (or -z), cparse parses many     *
+ * inputs in batch mode: every remaining argument is a file to parse, or,       *
+ * without any, standard-in is split into one input per line (-z: per NUL       *
+ * byte). -j sets the number of worker threads, and -i the number of parses     *
+ * each worker interleaves to overlap table-lookup latency. With -s, a single   *
+ * large input (a file argument or standard-in) is split after the given sync   *
+ * tokens and the pieces are parsed on -j threads. In a cparse-stats build, -S  *
+ * writes the hot-path counters to a JSON file when the parse is done.          *
  *******************************************************************************/
-int main() {
-    std::stack<int> stateStack;
-    stateStack.push(0);
-    std::map<char, int> terminalIndex = getTerminalMap();
-
-    char curr, currentLetter;
-    while (std::cin >> curr && curr != '$') {
-        currentLetter = curr;
-
-        // check if the current token is in the set of tokens; if not, exit
-        if (isBadToken(currentLetter)) {
-            std::cerr << "Bad token: " << currentLetter << std::endl;
-            exit(0);
+int main(int argc, char *argv[]) {
+    TraceFormat format = TraceFormat::TEXT;
+    const char *outName = nullptr;
+    bool batch = false;
+    bool printTree = false;
+    const char *syncTokens = nullptr;
+    char delimiter = '\n';
+    unsigned threads = std::thread::hardware_concurrency();
+    size_t lanes = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:Tbzj:i:s:S:")) != -1) {
+        switch (opt) {
+            case 'f':
+                format = getTraceFormat(optarg);
+                break;
+            case 'o':
+                outName = optarg;
+                break;
+            case 'T':
+                printTree = true;
+                break;
+            case 'b':
+                batch = true;
+                break;
+            case 'z':
+                batch = true;
+                delimiter = '\0';
+                break;
+            case 'j':
+                threads = (unsigned) atoi(optarg);
+                break;
+            case 'i':
+                lanes = (size_t) atoi(optarg);
+                break;
+            case 's':
+                syncTokens = optarg;
+                break;
+            case 'S':
+                statsName = optarg;
+                break;
+            default:
+                std::cerr << "Usage: cparse [-f text|binary|rle|count] [-o file] [-T]\n"
+                          << "       cparse -b|-z [-j threads] [-i lanes] [file ...]\n"
+                          << "       cparse -s tokens [-j threads] [-f fmt] [-o file] [-T] [file]\n"
+                          << "       (any mode) [-S stats.json]" << std::endl;
+                exit(0);
         }
+    }
 
-        int termIndex = terminalIndex[currentLetter];
-        int currentState = stateStack.top();
-
-        char act = action[currentState][termIndex];
-        int actionNum = action_num[currentState][termIndex];
+    const ParseTables &tables = getParseTables();
+#ifndef CPARSE_STATS
+    if (statsName != nullptr) {
+        std::cerr << "-S needs a cparse-stats build" << std::endl;
+        exit(0);
+    }
+#endif
+    if (batch) return parseBatch(tables, argc - optind, argv + optind, delimiter, threads, lanes);
 
-        while(act == 'r') {
-            for (int i = 0; i < reduce_num[actionNum]; i++)
-                stateStack.pop();
+    std::FILE *out = stdout;
+    if (outName != nullptr && (out = std::fopen(outName, "wb")) == nullptr) {
+        std::cerr << "Could not open " << outName << std::endl;
+        exit(0);
+    }
+    TraceWriter trace(out, format, tables.numProds);
+    if (syncTokens != nullptr)
+        return parseSplit(tables, trace, printTree, syncTokens, threads, optind < argc ? argv[optind] : nullptr);
+    return parseSingle(tables, trace, printTree);
+}
 
-            std::cout << "reduce " << std::to_string(actionNum) << std::endl;
-            currentState = stateStack.top();
-            int lhs = reduce_lhs[actionNum];
-            stateStack.push(go_to[currentState][lhs]);
-            if (stateStack.size() >= 100) {
-                std::cout << "\nStack overflow occurred.\n";
-                exit(0);
-            }
-            currentState = stateStack.top();
+ /*******************************************************************************
+ * parseSingle: Collects the input from standard-in and pushes it to the parser *
+ * a block at a time, until the '$' token or the end of the input. The stack    *
+ * starts with the '0' start state; a stack of 100 states is an overflow. The   *
+ * trace is finished before the result is reported.                             *
+ * When printTree is set, the parse tree is built (and printed on an accept)    *
+ * instead of tracing the reductions.                                           *
+ *******************************************************************************/
+int parseSingle(const ParseTables &tables, TraceWriter &trace, bool printTree) {
+    ParseTree tree(tables);
+    Parser parser(tables, printTree ? (ParseListener *) &tree : &trace);
 
-            act = action[currentState][termIndex];
-            actionNum = action_num[currentState][termIndex];
-        }
+    char buffer[1 << 16];
+    size_t length;
+    while ((length = std::fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+        if (parser.feed(buffer, length) != ParseStatus::NEED_MORE) break;
+    }
+    parser.finish();
 
-        switch(act) {
-            case 'e':
-                std::cout << "\nError state on token '" << currentLetter
-                << "' at state " << std::to_string(currentState) << ".\n";
-                exit(0);
-            case 'a':
-                std::cout << "\nAccept state reached." << std::endl;
-                exit(1);
-            default:
-                stateStack.push(actionNum);
-                if (stateStack.size() >= 100) {
-                    std::cout << "\nStack overflow occurred.\n";
-                    exit(0);
-                }
-                currentState = stateStack.top();
-                break;
-        }
+    return reportResult(parser.getResult(), trace, tree, printTree);
+}
 
+ /*******************************************************************************
+ * parseSplit: Parses one large input with a SplitParser. A file argument is    *
+ * mapped into memory; without one, standard-in is read in full first. The      *
+ * trace and the result are the same as parseSingle's.                          *
+ *******************************************************************************/
+int parseSplit(const ParseTables &tables, TraceWriter &trace, bool printTree, const char *syncTokens,
+               unsigned threads, const char *fileName) {
+    SplitParser splitParser(tables, syncTokens, threads);
+    if (!splitParser.hasSyncTokens()) {
+        std::cerr << "No usable sync tokens in: " << syncTokens << std::endl;
+        exit(0);
     }
 
-    // signifiy that the current token is the end-of-input token
-    // this is done because the main while-loop, which collected the tokens
-    // has ended without issue. The remaining tokens on the stack must now
-    // be reduced and checked if they're an error or within the accept. 
-    // If the stack increases past 100 tokens, then a stack-overflow occurs. 
-    currentLetter = '$';
-    int termIndex = terminalIndex[currentLetter];
-    int currentState = stateStack.top();
-
-    char act = action[currentState][termIndex];
-    int actionNum = action_num[currentState][termIndex];
-
-    while(act == 'r') {
-        for (int i = 0; i < reduce_num[actionNum]; i++)
-            stateStack.pop();
-
-        std::cout << "reduce " << std::to_string(actionNum) << std::endl;
-        currentState = stateStack.top();
-        int lhs = reduce_lhs[actionNum];
-        stateStack.push(go_to[currentState][lhs]);
-        if (stateStack.size() >= 100) {
-            std::cout << "\nStack overflow occurred.\n";
+    std::vector<char> input;
+    const char *begin = nullptr;
+    size_t length = 0;
+    void *mapped = MAP_FAILED;
+    if (fileName != nullptr) {
+        int fd = open(fileName, O_RDONLY);
+        struct stat info;
+        if (fd == -1 || fstat(fd, &info) == -1) {
+            std::cerr << "Could not open " << fileName << std::endl;
             exit(0);
         }
-        currentState = stateStack.top();
-
-        act = action[currentState][termIndex];
-        actionNum = action_num[currentState][termIndex];
-    }
-
-    if (act == 'e') {
-        std::cout << "\nError state on token '" << currentLetter
-                  << "' at state " << std::to_string(currentState) << ".\n";
-        exit(0);
+        length = (size_t) info.st_size;
+        if (length > 0) mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (length > 0 && mapped == MAP_FAILED) {
+            std::cerr << "Could not map " << fileName << std::endl;
+            exit(0);
+        }
+        if (mapped != MAP_FAILED) begin = static_cast<const char *>(mapped);
     } else {
-        std::cout << "\nAccept state reached." << std::endl;
+        char buffer[1 << 16];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), stdin)) > 0)
+            input.insert(input.end(), buffer, buffer + n);
+        begin = input.data();
+        length = input.size();
     }
 
+    ParseTree tree(tables);
+    ParseResult result = splitParser.parse(begin, begin + length, printTree ? (ParseListener *) &tree : &trace);
+    int status = reportResult(result, trace, tree, printTree);
+    if (mapped != MAP_FAILED) munmap(mapped, length);
+    return status;
 }
 
  /*******************************************************************************
- * getTerminalMap: Creates a map of the terminals and their index into the      * 
- * token array for ease-of-use. This way, during algorithm, when a token is     *
- * needed for indexing, the map can return its proper index.                    *
- * Return: return the created (token, index) map.                               *
+ * reportResult: Finishes the trace with the parse's status, prints the tree    *
+ * on an accept when asked to, and writes the final message. Every result but   *
+ * an accept ends cparse.                                                       *
  *******************************************************************************/
-std::map<char, int> getTerminalMap() {
-    std::map<char, int> map;
-
-    int index = 0;
-    for (auto& term : tokens) {
-        map[term] = index++;
+int reportResult(const ParseResult &result, TraceWriter &trace, ParseTree &tree, bool printTree) {
+    writeStats(getParseTables());
+    switch (result.status) {
+        case ParseStatus::ACCEPT:
+            trace.finish('a');
+            if (printTree) tree.print(std::cout);
+            writeStatus(trace, "\n" + describeResult(result) + "\n");
+            return 0;
+        case ParseStatus::OVERFLOW:
+            trace.finish('o');
+            writeStatus(trace, "\n" + describeResult(result) + "\n");
+            exit(0);
+        case ParseStatus::BAD_TOKEN:
+            trace.finish('e');
+            std::cerr << describeResult(result) << std::endl;
+            exit(0);
+        default:
+            trace.finish('e');
+            writeStatus(trace, "\n" + describeResult(result) + "\n");
+            exit(0);
     }
+}
+
+ /*******************************************************************************
+ * parseBatch: Queues every file argument (or every record of standard-in when  *
+ * there are none) and parses them on the worker pool. One result line is       *
+ * written per input, in input order.                                           *
+ *******************************************************************************/
+int parseBatch(const ParseTables &tables, int argc, char *argv[], char delimiter,
+               unsigned threads, size_t lanes) {
+    BatchParser batchParser(tables, threads, lanes);
+    for (int i = 0; i < argc; i++)
+        batchParser.addFile(argv[i]);
+    if (argc == 0)
+        batchParser.addStream(std::cin, delimiter);
 
-    return map;
+    batchParser.run();
+    batchParser.writeResults(std::cout);
+    writeStats(tables);
+    return 0;
 }
 
  /*******************************************************************************
- * isBadToken: Checks whether or not the token passed into the parser is a bad  *
- * token. This is done by checking whether or not the token is in the tokens    *
- * array. If it's found, then it's a !badToken = good token.                    *                        
+ * getTraceFormat: Maps the -f argument onto a trace format. "text" keeps the   *
+ * original "reduce N" lines, "binary" and "rle" write varint production ids    *
+ * (rle collapses repeated reductions into runs), and "count" only prints a     *
+ * per-production summary at the end of the parse.                              *
  *******************************************************************************/
-bool isBadToken(char token) {
-    for (auto& term : tokens) {
-        if (term == token) return false;
-    }
+TraceFormat getTraceFormat(const char *name) {
+    if (strcmp(name, "text") == 0) return TraceFormat::TEXT;
+    if (strcmp(name, "binary") == 0) return TraceFormat::BINARY;
+    if (strcmp(name, "rle") == 0) return TraceFormat::RLE;
+    if (strcmp(name, "count") == 0) return TraceFormat::COUNT;
+
+    std::cerr << "Unknown trace format: " << name << std::endl;
+    exit(0);
+}
 
-    return true;
-}
\ No newline at end of file
+ /*******************************************************************************
+ * writeStatus: Prints the final parser message once the trace has been flushed *
+ * so the two never interleave. Binary traces own the output stream, so their   *
+ * messages go to standard error instead.                                       *
+ *******************************************************************************/
+void writeStatus(TraceWriter &trace, const std::string &message) {
+    if (trace.getFormat() == TraceFormat::BINARY || trace.getFormat() == TraceFormat::RLE)
+        std::cerr << message;
+    else
+        std::cout << message << std::flush;
+}
+
+// Writes the merged counters of every thread to the -S file, if one was given
+void writeStats(const ParseTables &tables) {
+    if (statsName == nullptr) return;
+
+    std::ofstream out(statsName);
+    if (!out) {
+        std::cerr << "Could not open " << statsName << std::endl;
+        return;
+    }
+    ParseStats::collect().writeJSON(out, tables);
+}
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <cctype>
+#include <unistd.h>
+#include "GrammarReader.h"
+#include "SentenceGenerator.h"
+
+void writeYacc(const Grammar& grammar);
+std::string yaccSymbol(char symbol);
+
+ /*******************************************************************************
+ * main(): Reads the Augmented Grammar section of items.txt from standard in    *
+ * and writes -n random sentences of it, one per line, ready for cparse -b or   *
+ * cbench. Each sentence aims for a size drawn evenly from [s/2, 3s/2] tokens   *
+ * and a derivation at most -d levels deep; -r seeds the generator so the same  *
+ * options always give the same sentences. With -y, gensent instead writes a    *
+ * yacc grammar for the same language with a timing driver, to compare cparse   *
+ * against a yacc-generated parser on the same sentences.                       *
+ *******************************************************************************/
+int main(int argc, char *argv[]) {
+    size_t count = 1000;
+    size_t size = 20;
+    size_t depth = 30;
+    unsigned seed = 1;
+    bool yacc = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:d:r:y")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = (size_t) atol(optarg);
+                break;
+            case 's':
+                size = (size_t) atol(optarg);
+                break;
+            case 'd':
+                depth = (size_t) atol(optarg);
+                break;
+            case 'r':
+                seed = (unsigned) atol(optarg);
+                break;
+            case 'y':
+                yacc = true;
+                break;
+            default:
+                std::cerr << "Usage: gensent [-n count] [-s size] [-d depth] [-r seed] < items.txt\n"
+                          << "       gensent -y < items.txt > parser.y" << std::endl;
+                exit(0);
+        }
+    }
+
+    Grammar grammar = getAugmentedGrammar();
+    if (yacc) {
+        writeYacc(grammar);
+        return 0;
+    }
+
+    SentenceGenerator generator(grammar, seed);
+    std::mt19937 sizes(seed);
+    size_t low = std::max((size_t) 1, size / 2);
+    std::uniform_int_distribution<size_t> targetSize(low, std::max(low, size + size / 2));
+    for (size_t i = 0; i < count; i++)
+        std::cout << generator.generate(targetSize(sizes), depth) << '\n';
+
+    return 0;
+}
+
+// Names a grammar symbol in yacc: terminals are character literals, the
+// start symbol ' is "start", and nonterminal X is N_X.
+std::string yaccSymbol(char symbol) {
+    if (symbol == '\'') return "start";
+    if (std::isupper(symbol)) return std::string("N_") + symbol;
+    if (symbol == '\\') return std::string("'\\") + symbol + "'";
+    return std::string("'") + symbol + "'";
+}
+
+ /*******************************************************************************
+ * writeYacc(): Writes the grammar as a yacc file. Every rule but the start     *
+ * rule counts a reduction, like cparse's trace. The generated main reads the   *
+ * same one-sentence-per-line input as cbench, parses it five times and         *
+ * reports the best run in the same form, so the two can be compared directly.  *
+ *******************************************************************************/
+void writeYacc(const Grammar& grammar) {
+    const std::vector<Production>& prods = grammar.getProductions();
+    std::cout << "%{\n"
+                 "#include <stdio.h>\n"
+                 "#include <stdlib.h>\n"
+                 "#include <string.h>\n"
+                 "#include <time.h>\n"
+                 "static const char *cursor;\n"
+                 "static unsigned long reductions, tokens;\n"
+                 "int yylex(void);\n"
+                 "void yyerror(const char *msg);\n"
+                 "%}\n"
+                 "%%\n";
+
+    for (size_t i = 0; i < prods.size(); i++) {
+        const std::string& head = prods[i].getHead();
+        bool first = i == 0 || prods[i - 1].getHead() != head;
+        bool last = i + 1 == prods.size() || prods[i + 1].getHead() != head;
+
+        std::cout << (first ? yaccSymbol(head[0]) + "\n    : " : "    | ");
+        for (char symbol : prods[i].getBody()) std::cout << yaccSymbol(symbol) << ' ';
+        std::cout << (i == 0 ? "{ }\n" : "{ reductions++; }\n");
+        if (last) std::cout << "    ;\n";
+    }
+
+    std::cout << "%%\n"
+                 "int yylex(void) {\n"
+                 "    while (*cursor == ' ' || *cursor == '\\t' || *cursor == '\\r') cursor++;\n"
+                 "    if (*cursor == '\\0' || *cursor == '\\n' || *cursor == '$') return 0;\n"
+                 "    tokens++;\n"
+                 "    return (unsigned char) *cursor++;\n"
+                 "}\n"
+                 "\n"
+                 "void yyerror(const char *msg) { (void) msg; }\n"
+                 "\n"
+                 "int main(void) {\n"
+                 "    size_t size = 0, capacity = 1 << 16, n;\n"
+                 "    char *input = malloc(capacity + 1);\n"
+                 "    while ((n = fread(input + size, 1, capacity - size, stdin)) > 0) {\n"
+                 "        size += n;\n"
+                 "        if (size == capacity) input = realloc(input, (capacity *= 2) + 1);\n"
+                 "    }\n"
+                 "    input[size] = '\\0';\n"
+                 "\n"
+                 "    double best = 0;\n"
+                 "    unsigned long sentences = 0, errors = 0;\n"
+                 "    for (int run = 0; run < 5; run++) {\n"
+                 "        struct timespec start, end;\n"
+                 "        sentences = errors = reductions = tokens = 0;\n"
+                 "        clock_gettime(CLOCK_MONOTONIC, &start);\n"
+                 "        for (const char *line = input; *line != '\\0'; ) {\n"
+                 "            const char *next = strchr(line, '\\n');\n"
+                 "            next = next ? next + 1 : line + strlen(line);\n"
+                 "            if (*line != '\\n') {\n"
+                 "                cursor = line;\n"
+                 "                sentences++;\n"
+                 "                if (yyparse() != 0) errors++;\n"
+                 "            }\n"
+                 "            line = next;\n"
+                 "        }\n"
+                 "        clock_gettime(CLOCK_MONOTONIC, &end);\n"
+                 "        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;\n"
+                 "        if (run == 0 || seconds < best) best = seconds;\n"
+                 "    }\n"
+                 "\n"
+                 "    printf(\"yacc: %lu sentences, %lu errors, %lu tokens, %lu reductions\\n\",\n"
+                 "           sentences, errors, tokens, reductions);\n"
+                 "    printf(\"yacc: %.3f s, %.0f tokens/sec, %.0f reductions/sec\\n\",\n"
+                 "           best, tokens / best, reductions / best);\n"
+                 "    free(input);\n"
+                 "    return 0;\n"
+                 "}\n";
+}
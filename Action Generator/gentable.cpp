@@ -1,19 +1,22 @@
 #include <iostream>
+#include <fstream>
 #include <cstring>
 #include <regex>
+#include <unistd.h>
 #include "constants.h"
+#include "GrammarAnalysis.h"
+#include "GrammarReader.h"
+#include "LRBuilder.h"
 #include "TableGenerator.h"
 
-void getHeader(const std::string& header, const std::string& line);
 void getStateHeader(const std::string& input);
 int getDigit(const std::string& input);
-Grammar getAugmentedGrammar();
 Follows getFollows(const Grammar& grammar);
 LRSet getSets(const Grammar& grammar, const Follows& follows);
 Item getItem(const std::string& item, const Follows& follows, const Grammar& grammar);
 void getGotoInfo(const std::string& input, std::map<char, int>& gotoMap, const Follows& follows, const Grammar& grammar);
-void printExpectedError(const std::string& expected, const std::string& got);
-std::pair<std::string, std::string> cleanProduction(const std::string& prod);
+std::vector<unsigned long> readProfile(const std::string& fileName);
+void reportStackDepth(const Grammar& grammar, const TableGenerator& tableGenerator);
 
  /*******************************************************************************
  * main(): Gets the grammar from standard in. Then retrieves the Follows obj.   *
@@ -21,12 +24,33 @@ std::pair<std::string, std::string> cleanProduction(const std::string& prod);
  * the LR(0) set is created using both objects for error-checking. When all the *
  * input is finished, and the checks passed, the table is generated using       *
  * an instance of the TableGenerator class, which relies on all 3 inputs.       *
+ * With -p, the states are renumbered by the visit counts in a cparse-stats     *
+ * profile so the hot rows of the tables are stored together.                   *
+ * With -r, simple right-recursive lists are rewritten as left-recursive ones;  *
+ * the Follows and LR(0) sets of the rewritten grammar are then built here and  *
+ * the rest of items.txt is not read. The stack-depth analysis goes to stderr.  *
  *******************************************************************************/
-int main() {
+int main(int argc, char *argv[]) {
+    const char *profileName = nullptr;
+    bool rewrite = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:r")) != -1) {
+        if (opt == 'p') {
+            profileName = optarg;
+        } else if (opt == 'r') {
+            rewrite = true;
+        } else {
+            std::cerr << "Usage: gentable [-p profile.json] [-r] < items.txt" << std::endl;
+            exit(0);
+        }
+    }
+
+    std::vector<std::string> rewritten;
+    Grammar grammar = rewrite ? rewriteRightRecursion(getAugmentedGrammar(), rewritten) : getAugmentedGrammar();
+    for (auto& rule : rewritten) std::cerr << "Rewrote " << rule << std::endl;
 
-    Grammar grammar = getAugmentedGrammar();
-    Follows follows = getFollows(grammar);
-    LRSet set = getSets(grammar, follows);
+    Follows follows = rewrite ? LRBuilder(grammar).getFollows() : getFollows(grammar);
+    LRSet set = rewrite ? LRBuilder(grammar).getSets() : getSets(grammar, follows);
 
     TableGenerator tableGenerator(
             set.numOfStates(),
@@ -35,101 +59,27 @@ int main() {
             grammar.getNumOfProds()
             );
 
+    if (profileName != nullptr) tableGenerator.setProfile(readProfile(profileName));
     tableGenerator.generateTable(grammar, follows, set);
+    reportStackDepth(grammar, tableGenerator);
 
 }
 
  /*******************************************************************************
- * getHeader(): For each section in the input, there is an Augmented Grammar,   *
- * Follows information, and an LR(0) Set. These have specific headers that are  *
- * defines in the constants.h file and have to correspond correctly to the input*
- * otherwise, there's an error and the program exits. The header (title and line*
- * ) must match the constant.                                                   *
- *******************************************************************************/
-void getHeader(const std::string& header, const std::string& line) {
-    std::string input;
-    std::getline(std::cin, input);
-    if (input != header) {
-        printExpectedError(header, input);
-        exit(0);
-    }
-
-    std::getline(std::cin, input);
-    if (input != line) {
-        printExpectedError(line, input);
-        exit(0);
-    }
-}
-
- /*******************************************************************************
- * cleanProduction(): From the Grammar section, the line is cleaned and added   *
- * as a production object. If there's no arrow, the production is invalid. Also *
- * checks if the nonterminal symbols are proper (upper and alphabetic or ').    *
- * Checks that the production body only contains valid symbols.                 *
+ * reportStackDepth(): Tells which nonterminals let the parse stack grow        *
+ * without bound, or, when none do, the deepest the stack can get. -r can fix   *
+ * the simple right-recursive lists among them.                                 *
  *******************************************************************************/
-std::pair<std::string, std::string> cleanProduction(const std::string& prod) {
-    std::string arrow = "->";
-    size_t locationOfArrow = prod.find(arrow);
-    if (locationOfArrow == std::string::npos) {
-        std::cerr << "Invalid production: " << prod << std::endl;
-        exit(0);
-    }
-
-    std::string head = prod.substr(0, locationOfArrow);
-    if (!(isupper(head[0]) && isalpha(head[0])) && head[0] != '\'') {
-        std::cerr << "Invalid nonterm " << head[0] << std::endl;
-        exit(0);
-    }
-
-    std::string body = prod.substr(locationOfArrow + 2, prod.length());
-    size_t errorPos = std::string::npos;
-    if (body.find(' ') != errorPos || body.find('\t') != errorPos ||
-            body.find('$') != errorPos || body.find('\n') != errorPos ||
-            body.find('\'') != errorPos) {
-        std::cerr << "Invalid production: " << prod << std::endl;
-        exit(0);
+void reportStackDepth(const Grammar& grammar, const TableGenerator& tableGenerator) {
+    std::vector<char> unbounded = findUnboundedNonTerminals(grammar);
+    if (!unbounded.empty()) {
+        std::cerr << "Unbounded stack depth through:";
+        for (char nonTerm : unbounded) std::cerr << " " << nonTerm;
+        std::cerr << std::endl;
     }
 
-    return {head, body};
-}
-
- /*******************************************************************************
- * getAugmentedGrammar(): Goes through each line of the Grammar section and     *
- * ensures a valid production. If it's valid, a production object is passed back*
- * and stored into the production map and the production vector. These two DS   *
- * create the Grammar. This way, the productions are in indexed order.          *
- *******************************************************************************/
-Grammar getAugmentedGrammar() {
-    getHeader(AUGMENTED, AUGMENTED_LINE);
-
-    std::string input;
-    int i = 0;
-    std::vector<Production> prods;
-    std::map<std::string, std::vector<std::string>> prodMap;
-
-    std::getline(std::cin, input);
-    while (!input.empty()) {
-        std::pair<std::string, std::string> pair = cleanProduction(input);
-        std::string head, body;
-        Production currProd(i, pair.first, pair.second);
-
-        if (i == 0 && currProd.getHead() != "'") {
-            std::cerr << "Invalid start symbol for Augmented Grammar" << std::endl;
-            exit(0);
-        }
-
-        if (i > 0 && currProd.getHead() == "'") {
-            std::cerr << "Invalid nonterm '" << std::endl;
-            exit(0);
-        }
-
-        prods.push_back(currProd);
-        prodMap[currProd.getHead()].push_back(currProd.getBody());
-        std::getline(std::cin, input);
-        i++;
-    }
-
-    return {prodMap, prods};
+    if (tableGenerator.getMaxDepth() != 0)
+        std::cerr << "Maximum stack depth: " << tableGenerator.getMaxDepth() << std::endl;
 }
 
  /*******************************************************************************
@@ -152,7 +102,7 @@ Follows getFollows(const Grammar& grammar) {
         char nonTerminal = input[0];
         nonTerminalSet.insert(nonTerminal);
         nonTermIndex[nonTerminal] = index++;
-        for (int i = 1; i < input.size(); i++) {
+        for (size_t i = 1; i < input.size(); i++) {
             if (isspace(input[i])) continue;
             if ((std::isalpha(input[i]) && std::isupper(input[i])) || !grammar.isTerminal(input[i])) {
                 std::cerr << "Invalid terminal: " << input[i] << std::endl;
@@ -166,7 +116,7 @@ Follows getFollows(const Grammar& grammar) {
     }
 
     std::vector<Production> prods = grammar.getProductions();
-    for (int i = 1; i < prods.size(); i++) {
+    for (size_t i = 1; i < prods.size(); i++) {
         char head = prods[i].getHead()[0];
         if (nonTerminalSet.find(head) == nonTerminalSet.end()) {
             std::cerr << "Invalid non-terminal " << head << std::endl;
@@ -195,7 +145,7 @@ void getStateHeader(const std::string& input) {
  *******************************************************************************/
 int getDigit(const std::string& input) {
     int start = -1; int end = -1;
-    for (int i = 0; i < input.size(); i++) {
+    for (size_t i = 0; i < input.size(); i++) {
         if (std::isdigit(input[i]) && start == -1) {
             start = i;
         }
@@ -318,10 +268,37 @@ LRSet getSets(const Grammar& grammar, const Follows& follows) {
     return {states};
 }
 
-void printExpectedError(const std::string& expected, const std::string& got) {
-    std::cerr << "Expected:\n" << "   " << expected << std::endl;
-    std::cerr << "Got:\n" << "   " << got << std::endl;
-    exit(0);
+ /*******************************************************************************
+ * readProfile(): Reads the "states" array of visit counts out of the JSON that *
+ * cparse-stats writes with -S. Only that one array is needed, so the file is   *
+ * searched for it rather than parsed as a whole.                               *
+ *******************************************************************************/
+std::vector<unsigned long> readProfile(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file) {
+        std::cerr << "Could not open " << fileName << std::endl;
+        exit(0);
+    }
+
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t key = json.find("\"states\"");
+    size_t open = json.find('[', key);
+    size_t close = json.find(']', open);
+    if (key == std::string::npos || open == std::string::npos || close == std::string::npos) {
+        std::cerr << "No \"states\" array in profile " << fileName << std::endl;
+        exit(0);
+    }
+
+    std::vector<unsigned long> visits;
+    std::istringstream counts(json.substr(open + 1, close - open - 1));
+    std::string count;
+    while (std::getline(counts, count, ',')) {
+        size_t start = count.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos) continue;
+        visits.push_back(std::stoul(count.substr(start)));
+    }
+
+    return visits;
 }
 
 
@@ -329,3 +306,4 @@ void printExpectedError(const std::string& expected, const std::string& got) {
 
 
 
+
@@ -1,4 +1,6 @@
 #include "quad.h"
+#include "quadbuf.h"
+#include "quadfile.h"
 #include "sym.h"
 #include <iostream>
 #include <regex>
@@ -27,12 +29,19 @@
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <climits>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -70,10 +79,12 @@ void branch(char *truthTemp, char *trueLabel, char *falseLabel, struct id_entry
 void jump(char *destination, struct id_entry *fn);
 void doNoop(struct id_entry *fn);
 void doEmptyFuncEnd(struct id_entry *fn);
+static void simplifyBlocks(struct bblk *top);
+static GlobalVariable *createString(const char *str);
 
 
 /* https://llvm.org/docs/tutorial/MyFirstLanguageFrontend/LangImpl08.html#choosing-a-target */
-void InitializeModuleAndPassManager() {
+static void InitializeModule() {
 
     auto TargetTriple = sys::getDefaultTargetTriple();
     InitializeNativeTarget();
@@ -97,37 +108,106 @@ void InitializeModuleAndPassManager() {
     TheModule = std::make_unique<Module>("QuadReader", TheContext);
     TheModule->setDataLayout(TargetMachine->createDataLayout());
     TheModule->setTargetTriple(TargetTriple);
+}
 
-    // We rely on printf function call
-    char str[] = "printf";
-    struct id_entry *iptr = install(str, GLOBAL);
+/*
+ * Declare the library functions the programs rely on: printf, exit and getchar.
+ */
+static Function *createPrintf() {
     FunctionType *printfTy = FunctionType::get(Builder.getInt32Ty(),
                                                Builder.getInt8PtrTy(), true);
-    iptr->v.f = Function::Create(printfTy, Function::ExternalLinkage,
-                                 str, *TheModule);
-    iptr->v.f->setCallingConv(CallingConv::C);
-    iptr->v.f->getArg(0)->setName("f");
+    Function *f = Function::Create(printfTy, Function::ExternalLinkage,
+                                   "printf", *TheModule);
+    f->setCallingConv(CallingConv::C);
+    f->getArg(0)->setName("f");
+    return f;
+}
+
+static Function *createExit() {
+    FunctionType *exitTy = FunctionType::get(Builder.getVoidTy(), Builder.getInt32Ty(), false);
+    Function *f = Function::Create(exitTy, Function::ExternalLinkage,
+                                   "exit", *TheModule);
+    f->setCallingConv(CallingConv::C);
+    f->getArg(0)->setName("exitF");
+    return f;
+}
+
+static Function *createGetchar() {
+    FunctionType *getCharTy = FunctionType::get(Builder.getInt32Ty(),false);
+    Function *f = Function::Create(getCharTy, Function::ExternalLinkage,
+                                   "getchar", *TheModule);
+    f->setCallingConv(CallingConv::C);
+    return f;
+}
+
+void InitializeModuleAndPassManager() {
+    InitializeModule();
+
+    // We rely on printf function call
+    char str[] = "printf";
+    install(str, GLOBAL)->v.f = createPrintf();
 
     // Create exit function
     char exitStr[] = "exit";
-    auto exitPtr = install(exitStr, GLOBAL);
-    FunctionType *exitTy = FunctionType::get(Builder.getVoidTy(), Builder.getInt32Ty(), false);
-    exitPtr->v.f = Function::Create(exitTy, Function::ExternalLinkage,
-                                 exitStr, *TheModule);
-    exitPtr->v.f->setCallingConv(CallingConv::C);
-    exitPtr->v.f->getArg(0)->setName("exitF");
+    install(exitStr, GLOBAL)->v.f = createExit();
 
     // Create getchar function
     char getCharStr[] = "getchar";
-    auto getCharPtr = install(getCharStr, GLOBAL);
-    FunctionType *getCharTy = FunctionType::get(Builder.getInt32Ty(),false);
-    getCharPtr->v.f = Function::Create(getCharTy, Function::ExternalLinkage,
-                                    getCharStr, *TheModule);
-    getCharPtr->v.f->setCallingConv(CallingConv::C);
+    install(getCharStr, GLOBAL)->v.f = createGetchar();
 }
 
+/*
+ * Functions lowered from quads may be printed as soon as they are done, and
+ * their bodies dropped (see emitFunction). The module then only prints what
+ * is left: its globals and the functions it only declares.
+ */
+static bool streamFunctions = false;
+static bool streamed = false;
+static bool quadFailed = false;
+static std::unordered_set<const Function *> printedFunctions;
+
 void OutputModule() {
-    TheModule->print(outs(), nullptr);
+    if (!streamed) {
+        TheModule->print(outs(), nullptr);
+        return;
+    }
+    if (!TheModule->global_empty())
+        outs() << "\n";
+    for (auto &G : TheModule->globals()) {
+        G.print(outs());
+        outs() << "\n";
+    }
+    for (auto &F : *TheModule) {
+        if (!printedFunctions.count(&F)) {
+            outs() << "\n";
+            F.print(outs());
+        }
+    }
+}
+
+static void emitFunction(Function *F) {
+    if (!streamFunctions)
+        return;
+    if (!streamed) {
+        outs() << "; ModuleID = '" << TheModule->getModuleIdentifier() << "'\n"
+               << "source_filename = \"" << TheModule->getSourceFileName() << "\"\n"
+               << "target datalayout = \"" << TheModule->getDataLayoutStr() << "\"\n"
+               << "target triple = \"" << TheModule->getTargetTriple() << "\"\n";
+        streamed = true;
+    }
+    outs() << "\n";
+    F->print(outs());
+    F->deleteBody();
+    printedFunctions.insert(F);
+}
+
+static GlobalVariable *createGlobalVar(const char *name, Type *ltype) {
+    TheModule->getOrInsertGlobal(name, ltype);
+    GlobalVariable *gvar = TheModule->getNamedGlobal(name);
+    gvar->setLinkage(GlobalVariable::CommonLinkage);
+    gvar->setAlignment(MaybeAlign(16));
+    gvar->setInitializer(Constant::getNullValue(ltype));
+    return gvar;
 }
 
 static void createGlobal(struct id_entry *iptr) {
@@ -147,12 +227,7 @@ static void createGlobal(struct id_entry *iptr) {
         else
             iptr->u.ltype = Builder.getDoubleTy();
     }
-    TheModule->getOrInsertGlobal(iptr->i_name, iptr->u.ltype);
-    iptr->gvar = TheModule->getNamedGlobal(iptr->i_name);
-    iptr->gvar->setLinkage(GlobalVariable::CommonLinkage);
-    iptr->gvar->setAlignment(MaybeAlign(16));
-    if (iptr->u.ltype->isArrayTy())
-        iptr->gvar->setInitializer(ConstantAggregateZero::get(iptr->u.ltype));
+    iptr->gvar = createGlobalVar(iptr->i_name, iptr->u.ltype);
 }
 
 static void createFunction(struct id_entry *fn, struct quadline **ptr) {
@@ -278,11 +353,11 @@ void createLoad(struct quadline *ptr) {
  * is null (as the main loop). Each quadline is an instruction line that
  * needs to be processed. Before the main loop, check if the block is
  * either 1) empty (ptr == null) or 2) only contains "FUNC_END".
- * In either case, they need to be handled with no-ops.
+ * In either case, they need special handling: a jump on or a return.
  */
 void createBitcode(struct quadline *ptr, struct id_entry *fn) {
-    // if ptr is null, there are no lines in the block
-    // create a noop instruction (dummy alloca and br to successor)
+    // if ptr is null, there are no lines in the block: jump to the successor
+    // (simplifyBlocks leaves at most the entry empty)
     if (ptr == nullptr) {
         doNoop(fn);
         return;
@@ -420,42 +495,8 @@ void referenceString(char *destinationTemp, char *str) {
         // myStr not in the symbol table, so include it
         // Also declare it as a global variable
         myStr = install(str, -1);
-
-        // Create the char array
-        auto charType = IntegerType::get(TheContext, 8);
-        size_t strSize = strlen(str);
-        std::vector<Constant *> chars;
-        for (int i = 0; i < strSize; i++) {
-            if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == 'n') {
-                chars.push_back(ConstantInt::get(charType, '\n'));
-                i++;
-            } else if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == 't') {
-                chars.push_back(ConstantInt::get(charType, '\t'));
-                i++;
-            } else if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == 'r') {
-                chars.push_back(ConstantInt::get(charType, '\r'));
-                i++;
-            } else if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == '\\') {
-                chars.push_back(ConstantInt::get(charType, '\\'));
-                i++;
-            } else {
-                chars.push_back(ConstantInt::get(charType, str[i]));
-            }
-        }
-        chars.push_back(ConstantInt::get(charType, 0));
-
-        auto vecType = ArrayType::get(
-                charType, chars.size());
-        myStr->u.ltype = vecType;
-
-        // Add the string to the Module for global reference
-        auto globalVar = (GlobalVariable *) TheModule->getOrInsertGlobal("", vecType);
-        globalVar->setInitializer(ConstantArray::get(vecType, chars));
-        globalVar->setConstant(true);
-        globalVar->setLinkage(GlobalVariable::PrivateLinkage);
-        globalVar->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
-        globalVar->setAlignment(MaybeAlign(1));
-        myStr->gvar = globalVar;
+        myStr->gvar = createString(str);
+        myStr->u.ltype = myStr->gvar->getValueType();
 
         address->gvar = myStr->gvar;
         address->v.v = myStr->gvar;
@@ -467,6 +508,47 @@ void referenceString(char *destinationTemp, char *str) {
     }
 }
 
+/*
+ * Build the char-array global for a string literal, turning its escapes
+ * into single characters.
+ */
+static GlobalVariable *createString(const char *str) {
+    // Create the char array
+    auto charType = IntegerType::get(TheContext, 8);
+    size_t strSize = strlen(str);
+    std::vector<Constant *> chars;
+    for (int i = 0; i < strSize; i++) {
+        if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == 'n') {
+            chars.push_back(ConstantInt::get(charType, '\n'));
+            i++;
+        } else if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == 't') {
+            chars.push_back(ConstantInt::get(charType, '\t'));
+            i++;
+        } else if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == 'r') {
+            chars.push_back(ConstantInt::get(charType, '\r'));
+            i++;
+        } else if ((i + 1) < strSize && str[i] == '\\' && str[i + 1] == '\\') {
+            chars.push_back(ConstantInt::get(charType, '\\'));
+            i++;
+        } else {
+            chars.push_back(ConstantInt::get(charType, str[i]));
+        }
+    }
+    chars.push_back(ConstantInt::get(charType, 0));
+
+    auto vecType = ArrayType::get(
+            charType, chars.size());
+
+    // Add the string to the Module for global reference
+    auto globalVar = (GlobalVariable *) TheModule->getOrInsertGlobal("", vecType);
+    globalVar->setInitializer(ConstantArray::get(vecType, chars));
+    globalVar->setConstant(true);
+    globalVar->setLinkage(GlobalVariable::PrivateLinkage);
+    globalVar->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+    globalVar->setAlignment(MaybeAlign(1));
+    return globalVar;
+}
+
 /*
  * Process the call quadline. Get the argument count, the destination,
  * and the reference to the function. With the argument count,
@@ -555,47 +637,45 @@ void unary(char *destinationTemp, char *op, char *right) {
  * checking if it's a left- or right-shift or one of the relational operators
  * (<, >, <=, >=, !=, ==).
  */
-void binop(char *destinationTemp, char *left, const char *op, char *right) {
-    auto leftOp = lookup(left, 0);
-    auto rightOp = lookup(right, 0);
-    auto result = install(destinationTemp, LOCAL);
+static Value *createBinop(Value *left, Type *ltype, const char *op, Value *right, const char *name) {
+    Value *value = nullptr;
 
     switch(*op) {
         case '+':
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateAdd(leftOp->v.v, rightOp->v.v, "");
+            if (ltype->isIntegerTy())
+                value = Builder.CreateAdd(left, right, "");
             else
-                result->v.v = Builder.CreateFAdd(leftOp->v.v, rightOp->v.v, "");
+                value = Builder.CreateFAdd(left, right, "");
             break;
         case '-':
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateSub(leftOp->v.v, rightOp->v.v, "");
+            if (ltype->isIntegerTy())
+                value = Builder.CreateSub(left, right, "");
             else
-                result->v.v = Builder.CreateFSub(leftOp->v.v, rightOp->v.v, "");
+                value = Builder.CreateFSub(left, right, "");
             break;
         case '*':
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateMul(leftOp->v.v, rightOp->v.v, "");
+            if (ltype->isIntegerTy())
+                value = Builder.CreateMul(left, right, "");
             else
-                result->v.v = Builder.CreateFMul(leftOp->v.v, rightOp->v.v, "");
+                value = Builder.CreateFMul(left, right, "");
             break;
         case '/':
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateSDiv(leftOp->v.v, rightOp->v.v, "");
+            if (ltype->isIntegerTy())
+                value = Builder.CreateSDiv(left, right, "");
             else
-                result->v.v = Builder.CreateFDiv(leftOp->v.v, rightOp->v.v, "");
+                value = Builder.CreateFDiv(left, right, "");
             break;
         case '%':
-            result->v.v = Builder.CreateSRem(leftOp->v.v, rightOp->v.v, "");
+            value = Builder.CreateSRem(left, right, "");
             break;
         case '&':
-            result->v.v = Builder.CreateAnd(leftOp->v.v, rightOp->v.v, "");
+            value = Builder.CreateAnd(left, right, "");
             break;
         case '|':
-            result->v.v = Builder.CreateOr(leftOp->v.v, rightOp->v.v, "");
+            value = Builder.CreateOr(left, right, "");
             break;
         case '^':
-            result->v.v = Builder.CreateXor(leftOp->v.v, rightOp->v.v, "");
+            value = Builder.CreateXor(left, right, "");
             break;
         default:
             break;
@@ -606,50 +686,59 @@ void binop(char *destinationTemp, char *left, const char *op, char *right) {
      */
     if (op[0] == '<') {
         if (op[1] == '<') {         // do left-shift (T_INT only)
-            result->v.v = Builder.CreateShl(leftOp->v.v, rightOp->v.v, "");
+            value = Builder.CreateShl(left, right, "");
         } else if (op[1] == '=') {  // do <= (LE)
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateICmpSLE(leftOp->v.v, rightOp->v.v, destinationTemp);
+            if (ltype->isIntegerTy())
+                value = Builder.CreateICmpSLE(left, right, name);
             else
-                result->v.v = Builder.CreateFCmpOLE(leftOp->v.v, rightOp->v.v, destinationTemp);
+                value = Builder.CreateFCmpOLE(left, right, name);
         } else {                    // do regular less than (because the other two cases failed)
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateICmpSLT(leftOp->v.v, rightOp->v.v, destinationTemp);
+            if (ltype->isIntegerTy())
+                value = Builder.CreateICmpSLT(left, right, name);
             else
-                result->v.v = Builder.CreateFCmpOLT(leftOp->v.v, rightOp->v.v, destinationTemp);
+                value = Builder.CreateFCmpOLT(left, right, name);
         }
     }
 
     if (op[0] == '>') {
         if (op[1] == '>') {         // do right-shift (T_INT)
-            result->v.v = Builder.CreateAShr(leftOp->v.v, rightOp->v.v, "");
+            value = Builder.CreateAShr(left, right, "");
         } else if (op[1] == '=') {  // do >= (GE)
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateICmpSGE(leftOp->v.v, rightOp->v.v, destinationTemp);
+            if (ltype->isIntegerTy())
+                value = Builder.CreateICmpSGE(left, right, name);
             else
-                result->v.v = Builder.CreateFCmpOGE(leftOp->v.v, rightOp->v.v, destinationTemp);
+                value = Builder.CreateFCmpOGE(left, right, name);
         } else {                    // do regular > (GT), other cases false
-            if (leftOp->u.ltype->isIntegerTy())
-                result->v.v = Builder.CreateICmpSGT(leftOp->v.v, rightOp->v.v, destinationTemp);
+            if (ltype->isIntegerTy())
+                value = Builder.CreateICmpSGT(left, right, name);
             else
-                result->v.v = Builder.CreateFCmpOGT(leftOp->v.v, rightOp->v.v, destinationTemp);
+                value = Builder.CreateFCmpOGT(left, right, name);
         }
     }
 
     if (op[0] == '=' && op[1] == '=') {     // equal comparator
-        if (leftOp->u.ltype->isIntegerTy())
-            result->v.v = Builder.CreateICmpEQ(leftOp->v.v, rightOp->v.v, destinationTemp);
+        if (ltype->isIntegerTy())
+            value = Builder.CreateICmpEQ(left, right, name);
         else
-            result->v.v = Builder.CreateFCmpOEQ(leftOp->v.v, rightOp->v.v, destinationTemp);
+            value = Builder.CreateFCmpOEQ(left, right, name);
     }
 
     if (op[0] == '!' && op[1] == '=') {     // NE comparator
-        if (leftOp->u.ltype->isIntegerTy())
-            result->v.v = Builder.CreateICmpNE(leftOp->v.v, rightOp->v.v, destinationTemp);
+        if (ltype->isIntegerTy())
+            value = Builder.CreateICmpNE(left, right, name);
         else
-            result->v.v = Builder.CreateFCmpONE(leftOp->v.v, rightOp->v.v, destinationTemp);
+            value = Builder.CreateFCmpONE(left, right, name);
     }
 
+    return value;
+}
+
+void binop(char *destinationTemp, char *left, const char *op, char *right) {
+    auto leftOp = lookup(left, 0);
+    auto rightOp = lookup(right, 0);
+    auto result = install(destinationTemp, LOCAL);
+
+    result->v.v = createBinop(leftOp->v.v, leftOp->u.ltype, op, rightOp->v.v, destinationTemp);
     result->u.ltype = leftOp->u.ltype;
 }
 
@@ -711,14 +800,11 @@ void jump(char *destination, struct id_entry *fn) {
 }
 
 /*
- * Create a useless instruction, dummy-noop. This is used in empty blocks. The block then
- * needs an exit point, which is its successor. If the block is "entry," then
- * we use the top's successor (which is always L1). Otherwise,
+ * An empty block only needs an exit point, which is its successor. If the block
+ * is "entry," then we use the top's successor (which is always L1). Otherwise,
  * look-up the current block's successor and jump to it.
  */
 void doNoop(struct id_entry *fn) {
-    Builder.CreateAlloca(Type::getInt32Ty(TheContext), nullptr, "dummy-noop");
-
     StringRef currentBlock = Builder.GetInsertBlock()->getName();
     char name[256];
     strcpy(name, currentBlock.data());
@@ -826,6 +912,7 @@ void bitcodegen() {
     BasicBlock *BB = BasicBlock::Create(TheContext, "entry", fn->v.f);
     top->lbblk = BB;
     Builder.SetInsertPoint(BB);
+    simplifyBlocks(top);
 
     // allocate storage for the param
     // allocate storage for locals
@@ -846,3 +933,574 @@ void bitcodegen() {
     return;
 }
 
+/*
+ * The block a branch or jump label names.
+ */
+static struct bblk *labelBlock(char *label) {
+    struct id_entry *entry = lookup(label, 0);
+    return entry ? entry->blk : nullptr;
+}
+
+/*
+ * A block falls into its successor unless it ends in a jump, a return or
+ * the end of the function.
+ */
+static bool fallsThrough(struct bblk *blk) {
+    auto last = blk->lineend;
+    return last == nullptr || (last->type != RETURN && last->type != JUMP && last->type != FUNC_END);
+}
+
+/*
+ * simplifyBlocks:
+ * Tidies the function's block list before any code is made for it, so
+ * bitcodegen never has to emit placeholder instructions for blocks that
+ * do nothing.
+ * 1) Blocks that no path from the entry reaches are unlinked.
+ * 2) Edges into an empty block are retargeted to the block's successor,
+ *    in both the succs lists and the labels of the jump and branch lines.
+ *    The empty block is then unlinked.
+ * 3) A block that falls or jumps into the block below it absorbs that block
+ *    when it is the only predecessor, unless the block below is just
+ *    "fend" and so still needs its return.
+ */
+static void simplifyBlocks(struct bblk *top) {
+    std::map<struct bblk *, int> preds;
+    std::map<struct bblk *, struct bblk *> forward;
+    std::vector<struct bblk *> work = {top};
+
+    preds[top] = 1;     // the entry is always reached
+    while (!work.empty()) {
+        auto blk = work.back();
+        work.pop_back();
+        for (auto s = blk->succs; s; s = s->next) {
+            if (preds[s->ptr]++ == 0)
+                work.push_back(s->ptr);
+        }
+    }
+
+    // 2) an empty block goes on to its only successor, maybe another empty one
+    for (auto blk = top->down; blk; blk = blk->down) {
+        if (blk->lines != nullptr || blk->succs == nullptr || !preds[blk])
+            continue;
+        auto to = blk->succs->ptr;
+        for (int steps = 0; to != blk && to->lines == nullptr && to->succs && steps < (int) preds.size(); steps++)
+            to = to->succs->ptr;
+        if (to != blk && to->lines != nullptr)
+            forward[blk] = to;
+    }
+    auto retarget = [&](char *&label) {
+        auto to = forward.find(labelBlock(label));
+        if (to != forward.end())
+            label = to->second->label;
+    };
+    for (auto blk = top; blk; blk = blk->down) {
+        if (!preds[blk] || forward.count(blk))
+            continue;
+        for (auto s = blk->succs; s; s = s->next) {
+            auto to = forward.find(s->ptr);
+            if (to != forward.end()) {
+                preds[to->second] += 1;
+                s->ptr = to->second;
+            }
+        }
+        for (auto line = blk->lines; line; line = line->next) {
+            if (line->type == JUMP)
+                retarget(line->items[1]);
+            else if (line->type == BRANCH)
+                retarget(line->items[2]);
+        }
+    }
+
+    // 1), 2) unlink what is unreached or forwarded; 3) merge straight lines
+    for (auto blk = top; blk; blk = blk->down) {
+        while (blk->down && (!preds[blk->down] || forward.count(blk->down)))
+            blk->down = blk->down->down;
+
+        auto below = blk->down;
+        while (below && preds[below] == 1 && below->lines && below->lines->type != FUNC_END &&
+               blk->succs && blk->succs->next == nullptr && blk->succs->ptr == below) {
+            auto last = blk->lineend;
+            if (last && last->type == JUMP && !(last->prev && last->prev->type == BRANCH)) {
+                blk->lineend = last->prev;
+                if (last->prev)
+                    last->prev->next = nullptr;
+                else
+                    blk->lines = nullptr;
+            } else if (!fallsThrough(blk)) {
+                break;
+            }
+
+            below->lines->prev = blk->lineend;
+            if (blk->lineend)
+                blk->lineend->next = below->lines;
+            else
+                blk->lines = below->lines;
+            for (auto line = below->lines; line; line = line->next)
+                line->blk = blk;
+            blk->lineend = below->lineend;
+            blk->succs = below->succs;
+            blk->down = below->down;
+            while (blk->down && (!preds[blk->down] || forward.count(blk->down)))
+                blk->down = blk->down->down;
+            below = blk->down;
+        }
+    }
+}
+
+
+/*
+ * In-memory quads: each function's typed quads reach bitcodegenQuads once
+ * the function ends, through the queue below, so nothing is read back.
+ * Temps and labels are plain numbers, which index per-function vectors; names
+ * are only looked up for variables, through the function's own storage map
+ * and the module, so the front end's symbol table is left alone.
+ */
+struct QuadTemp {
+    Value *v = nullptr;
+    Type *ltype = nullptr;
+    const char *name = nullptr;     // global reference, for calls to functions not yet seen
+};
+
+static std::map<std::string, GlobalVariable *> quadStrings;
+
+static Type *quadType(int type, int numelem) {
+    Type *elem = type & T_INT ? Builder.getInt32Ty() : Builder.getDoubleTy();
+    if (type & T_ARRAY)
+        return ArrayType::get(elem, numelem);
+    return elem;
+}
+
+/*
+ * End a block that has no exit yet with the function's default return.
+ */
+static void quadDefaultReturn(Function *F) {
+    if (F->getReturnType()->isIntegerTy())
+        Builder.CreateRet(ConstantInt::get(Type::getInt32Ty(TheContext), 0));
+    else
+        Builder.CreateRet(ConstantFP::get(Type::getDoubleTy(TheContext), 0));
+}
+
+/*
+ * Create the function for a func quad and its formals, store each argument
+ * into its own slot, then allocate the locals. Leaves q after the last
+ * localloc.
+ */
+static Function *quadFunction(const struct quad_buffer *buf, const struct quad *&q, const struct quad *end,
+                              std::map<std::string, Value *> &storage) {
+    const char *name = quad_name(buf, q);
+    Type *retType = q->num & T_INT ? Builder.getInt32Ty() : Builder.getDoubleTy();
+
+    std::vector<Type *> typeVec;
+    std::vector<const char *> args;
+    for (q++; q < end && q->op == Q_FORMAL; q++) {
+        typeVec.push_back(quadType(q->num, 1));
+        args.push_back(quad_name(buf, q));
+    }
+
+    // a call may have declared the function before its definition
+    FunctionType *ftype = FunctionType::get(retType, typeVec, false);
+    Function *F = TheModule->getFunction(name);
+    if (F == nullptr || !F->empty() || F->getFunctionType() != ftype)
+        F = Function::Create(ftype, Function::ExternalLinkage, name, TheModule.get());
+
+    Builder.SetInsertPoint(BasicBlock::Create(TheContext, "entry", F));
+    unsigned Idx = 0;
+    for (auto &Arg : F->args()) {
+        Arg.setName(args[Idx]);
+        Value *slot = Builder.CreateAlloca(typeVec[Idx], nullptr, args[Idx]);
+        Builder.CreateStore(&Arg, slot);
+        storage[args[Idx++]] = slot;
+    }
+
+    for (; q < end && q->op == Q_LOCALLOC; q++) {
+        name = quad_name(buf, q);
+        storage[name] = Builder.CreateAlloca(quadType(q->num, q->a), nullptr, name);
+    }
+    return F;
+}
+
+/*
+ * Resolve the callee of a call quad. A function called before it is defined
+ * is declared from the call's own argument and result types.
+ */
+static Function *quadCallee(const QuadTemp &fn, char type, const std::vector<Value *> &args) {
+    if (auto F = dyn_cast_or_null<Function>(fn.v))
+        return F;
+    if (Function *F = TheModule->getFunction(fn.name))
+        return F;
+
+    std::vector<Type *> typeVec;
+    for (auto arg : args)
+        typeVec.push_back(arg->getType());
+    Type *retType = type == 'i' ? Builder.getInt32Ty() : Builder.getDoubleTy();
+    return Function::Create(FunctionType::get(retType, typeVec, false),
+                            Function::ExternalLinkage, fn.name, TheModule.get());
+}
+
+void bitcodegenQuads(const struct quad_buffer *buf) {
+    const struct quad *q = buf->quads, *end = buf->quads + buf->nquads;
+
+    // any global, then define
+    for (; q < end && q->op == Q_GLOBAL_ALLOC; q++)
+        createGlobalVar(quad_name(buf, q), quadType(q->num, q->a));
+    if (q == end)
+        return;
+    assert(q->op == Q_FUNC && "Function definition is expected");
+
+    // size the vectors by the range of temps and labels this function uses
+    int minTemp = INT_MAX, maxTemp = 0, minLabel = INT_MAX, maxLabel = 0;
+    std::map<int, int> patches;
+    for (auto p = q; p < end; p++) {
+        if (p->dst) {
+            minTemp = std::min(minTemp, p->dst);
+            maxTemp = std::max(maxTemp, p->dst);
+        }
+        if (p->op == Q_LABEL) {
+            minLabel = std::min(minLabel, p->label);
+            maxLabel = std::max(maxLabel, p->label);
+        } else if (p->op == Q_PATCH) {
+            patches[p->label] = p->num;
+        }
+    }
+    std::vector<QuadTemp> temps(minTemp <= maxTemp ? maxTemp - minTemp + 1 : 0);
+    std::vector<BasicBlock *> blocks(minLabel <= maxLabel ? maxLabel - minLabel + 1 : 0);
+    auto temp = [&](int t) -> QuadTemp & { return temps[t - minTemp]; };
+
+    std::map<std::string, Value *> storage;
+    Function *F = quadFunction(buf, q, end, storage);
+
+    // every name needs storage, except that a function's is enough for a call,
+    // and a goto to a label that was never declared leaves its branch unpatched
+    std::vector<bool> called(temps.size());
+    for (auto p = q; p < end; p++)
+        if (p->op == Q_CALL)
+            called[p->a - minTemp] = true;
+    for (auto p = q; p < end; p++) {
+        const char *name = quad_name(buf, p);
+        if ((p->op == Q_GLOBAL_REF && !TheModule->getNamedGlobal(name) && !called[p->dst - minTemp]) ||
+            ((p->op == Q_LOCAL_REF || p->op == Q_PARAM_REF) && !storage.count(name)))
+            errs() << "no storage for " << name << " in " << F->getName() << "\n";
+        else if ((p->op == Q_BR || p->op == Q_BT) && p->blank && !patches.count(p->label))
+            errs() << "branch to an undeclared label in " << F->getName() << "\n";
+        else
+            continue;
+        F->deleteBody();
+        quadFailed = true;
+        return;
+    }
+
+    auto block = [&](int label) {
+        BasicBlock *&bb = blocks[label - minLabel];
+        if (bb == nullptr)
+            bb = BasicBlock::Create(TheContext, "L" + std::to_string(label), F);
+        return bb;
+    };
+    auto target = [&](const struct quad *p) {
+        if (!p->blank)
+            return block(p->label);
+        auto patch = patches.find(p->label);
+        assert(patch != patches.end() && "branch is never backpatched");
+        return block(patch->second);
+    };
+    // code after a branch or return is unreachable, but still needs a block
+    auto live = [&]() {
+        if (Builder.GetInsertBlock()->getTerminator())
+            Builder.SetInsertPoint(BasicBlock::Create(TheContext, "", F));
+    };
+
+    Value *i32zero = ConstantInt::get(TheContext, APInt(32, 0));
+    for (; q < end; q++) {
+        const char *name = quad_name(buf, q);
+        switch (q->op) {
+            case Q_CON:
+                temp(q->dst) = {ConstantInt::get(Type::getInt32Ty(TheContext), std::stoi(name)),
+                                Type::getInt32Ty(TheContext)};
+                break;
+            case Q_STR: {
+                GlobalVariable *&str = quadStrings[name];
+                if (str == nullptr)
+                    str = createString(name);
+                temp(q->dst) = {str, str->getValueType()};
+                break;
+            }
+            case Q_GLOBAL_REF:
+                if (GlobalVariable *gvar = TheModule->getNamedGlobal(name))
+                    temp(q->dst) = {gvar, gvar->getValueType()};
+                else
+                    temp(q->dst) = {TheModule->getFunction(name), nullptr, name};
+                break;
+            case Q_LOCAL_REF:
+            case Q_PARAM_REF: {
+                auto slot = cast<AllocaInst>(storage[name]);
+                temp(q->dst) = {slot, slot->getAllocatedType()};
+                break;
+            }
+            case Q_UNARY: {
+                live();
+                QuadTemp &right = temp(q->a);
+                QuadTemp &result = temp(q->dst);
+                if (q->oper[0] == '@') {
+                    Type *type = right.v->getType()->getPointerElementType();
+                    result = {Builder.CreateLoad(type, right.v), type};
+                } else if (q->oper[0] == '-') {
+                    if (right.ltype->isIntegerTy())
+                        result = {Builder.CreateNeg(right.v), right.ltype};
+                    else
+                        result = {Builder.CreateFNeg(right.v), right.ltype};
+                } else {
+                    result = {Builder.CreateNot(right.v), right.ltype};
+                }
+                break;
+            }
+            case Q_CV:
+                live();
+                if (q->type == 'f')
+                    temp(q->dst) = {Builder.CreateSIToFP(temp(q->a).v, Type::getDoubleTy(TheContext)),
+                                    Type::getDoubleTy(TheContext)};
+                else
+                    temp(q->dst) = {Builder.CreateFPToSI(temp(q->a).v, Type::getInt32Ty(TheContext)),
+                                    Type::getInt32Ty(TheContext)};
+                break;
+            case Q_BINOP: {
+                live();
+                QuadTemp &left = temp(q->a);
+                std::string tname = "t" + std::to_string(q->dst);
+                temp(q->dst) = {createBinop(left.v, left.ltype, q->oper, temp(q->b).v, tname.c_str()),
+                                left.ltype};
+                break;
+            }
+            case Q_INDEX: {
+                live();
+                Value *array = temp(q->a).v;
+                Type *type = array->getType()->getPointerElementType();
+                Value *indices[2] = {i32zero, temp(q->b).v};
+                temp(q->dst) = {Builder.CreateInBoundsGEP(type, array, indices), type};
+                break;
+            }
+            case Q_STORE:
+                live();
+                Builder.CreateStore(temp(q->b).v, temp(q->a).v);
+                temp(q->dst) = temp(q->b);
+                break;
+            case Q_CALL: {
+                live();
+                std::vector<Value *> args;
+                const int *argTemps = quad_args(buf, q);
+                for (int i = 0; i < q->num; i++) {
+                    Value *arg = temp(argTemps[i]).v;
+                    if (arg->getType()->isPointerTy() && arg->getType()->getPointerElementType()->isArrayTy()) {
+                        Value *indices[2] = {i32zero, i32zero};
+                        arg = Builder.CreateInBoundsGEP(arg->getType()->getPointerElementType(), arg, indices);
+                    }
+                    args.push_back(arg);
+                }
+                Function *callee = quadCallee(temp(q->a), q->type, args);
+                // the front end passes arguments as they are; convert them to the parameters
+                for (unsigned i = 0; i < args.size() && i < callee->getFunctionType()->getNumParams(); i++) {
+                    Type *param = callee->getFunctionType()->getParamType(i);
+                    if (param->isDoubleTy() && args[i]->getType()->isIntegerTy())
+                        args[i] = Builder.CreateSIToFP(args[i], param);
+                    else if (param->isIntegerTy() && args[i]->getType()->isDoubleTy())
+                        args[i] = Builder.CreateFPToSI(args[i], param);
+                }
+                std::string tname = callee->getReturnType()->isVoidTy() ? "" : "t" + std::to_string(q->dst);
+                temp(q->dst) = {Builder.CreateCall(callee, args, tname), callee->getReturnType()};
+                break;
+            }
+            case Q_LABEL: {
+                BasicBlock *bb = block(q->label);
+                if (!Builder.GetInsertBlock()->getTerminator())
+                    Builder.CreateBr(bb);
+                Builder.SetInsertPoint(bb);
+                break;
+            }
+            case Q_BR:
+                live();
+                Builder.CreateBr(target(q));
+                break;
+            case Q_BT:
+                // rel always follows bt with the br of its false list
+                live();
+                assert(q + 1 < end && q[1].op == Q_BR && "bt without a false branch");
+                Builder.CreateCondBr(temp(q->a).v, target(q), target(q + 1));
+                q++;
+                break;
+            case Q_RET: {
+                live();
+                if (q->a < 0) {
+                    quadDefaultReturn(F);
+                    break;
+                }
+                Value *value = temp(q->a).v;
+                if (F->getReturnType() != value->getType()) {
+                    if (F->getReturnType()->isDoubleTy())
+                        value = Builder.CreateSIToFP(value, Type::getDoubleTy(TheContext));
+                    else
+                        value = Builder.CreateFPToSI(value, Type::getInt32Ty(TheContext));
+                }
+                Builder.CreateRet(value);
+                break;
+            }
+            default:    // bgnstmt, arg, fend and backpatches carry nothing to generate
+                break;
+        }
+    }
+
+    // fall off the end (or out of an unreachable block) with a default return
+    for (auto &bb : *F) {
+        if (bb.getTerminator() == nullptr) {
+            Builder.SetInsertPoint(&bb);
+            quadDefaultReturn(F);
+        }
+    }
+    emitFunction(F);
+}
+
+/*
+ * The in-memory compile is a pipeline. The front end's consumer copies each
+ * function's quads onto a short queue and goes back to parsing, while a
+ * second thread lowers them, prints the function and drops its body. So only
+ * the queued quads and the function being lowered are alive at once, and
+ * the LLVM objects are only ever touched by that thread. Functions are only
+ * printed as they finish while the front end leaves stdout alone, that is
+ * without the -q text dump; the choice is made as each copy is queued.
+ */
+struct QuadCopy {
+    std::vector<struct quad> quads;
+    std::vector<int> args;
+    std::vector<char> names;
+    bool stream;
+};
+
+static const size_t QUAD_QUEUE = 8;
+static std::deque<std::unique_ptr<QuadCopy>> quadQueue;
+static std::mutex quadLock;
+static std::condition_variable quadReady, quadRoom;
+static bool quadDone = false;
+static std::thread quadWorker;
+static pid_t quadPid;
+
+static void queueQuads(const struct quad_buffer *buf) {
+    auto copy = std::make_unique<QuadCopy>();
+    copy->quads.assign(buf->quads, buf->quads + buf->nquads);
+    copy->args.assign(buf->args, buf->args + buf->nargs);
+    copy->names.assign(buf->names, buf->names + buf->nnames);
+    copy->stream = !quad_text;
+
+    std::unique_lock<std::mutex> lock(quadLock);
+    quadRoom.wait(lock, [] { return quadQueue.size() < QUAD_QUEUE; });
+    quadQueue.push_back(std::move(copy));
+    lock.unlock();
+    quadReady.notify_one();
+}
+
+static void lowerQueued() {
+    for (;;) {
+        std::unique_lock<std::mutex> lock(quadLock);
+        quadReady.wait(lock, [] { return quadDone || !quadQueue.empty(); });
+        if (quadQueue.empty())
+            return;
+        std::unique_ptr<QuadCopy> copy = std::move(quadQueue.front());
+        quadQueue.pop_front();
+        lock.unlock();
+        quadRoom.notify_one();
+
+        streamFunctions = copy->stream;
+        struct quad_buffer buf;
+        buf.quads = copy->quads.data();
+        buf.nquads = buf.maxquads = (int) copy->quads.size();
+        buf.args = copy->args.data();
+        buf.nargs = buf.maxargs = (int) copy->args.size();
+        buf.names = copy->names.data();
+        buf.nnames = buf.maxnames = (int) copy->names.size();
+        bitcodegenQuads(&buf);
+    }
+}
+
+static void InitializeQuadModule() {
+    InitializeModule();
+    createPrintf();
+    createExit();
+    createGetchar();
+}
+
+/*
+ * An exit before bitcodegenFinish, such as on a failed -j parse or out of
+ * memory, would destroy the thread while it can still be joined. Stop it
+ * here instead, dropping whatever is still queued. A forked front end only
+ * has the handle, not the thread, so it lets go of the handle.
+ */
+static void stopQuadWorker() {
+    if (!quadWorker.joinable())
+        return;
+    if (getpid() != quadPid) {
+        quadWorker.detach();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(quadLock);
+        quadQueue.clear();
+        quadDone = true;
+    }
+    quadReady.notify_one();
+    if (quadWorker.get_id() == std::this_thread::get_id())
+        quadWorker.detach();
+    else
+        quadWorker.join();
+}
+
+/*
+ * bitcodegenInit and bitcodegenFinish bracket an in-memory compile: the module
+ * is opened, the lowering thread started and the front end told to queue its
+ * quads for it; at the end the queue is drained and the rest of the module
+ * printed.
+ */
+extern "C" void bitcodegenInit() {
+    InitializeQuadModule();
+    quad_set_consumer(queueQuads);
+    quadWorker = std::thread(lowerQueued);
+    quadPid = getpid();
+    atexit(stopQuadWorker);
+}
+
+extern "C" int bitcodegenFinish() {
+    {
+        std::lock_guard<std::mutex> lock(quadLock);
+        quadDone = true;
+    }
+    quadReady.notify_one();
+    quadWorker.join();
+    fflush(stdout);
+    if (quadFailed)
+        return 0;
+    OutputModule();
+    return 1;
+}
+
+/*
+ * Compile a binary quad file written by a separate front-end run. The file
+ * is mapped, and each function's block is lowered where it lies: quads,
+ * arguments and names are read straight from the mapping, never copied.
+ */
+extern "C" int bitcodegenQuadFile(const char *path) {
+    struct quad_file file;
+    struct quad_buffer buf;
+
+    if (!quadfile_map(path, &file))
+        return 0;
+    InitializeQuadModule();
+    streamFunctions = true;
+    for (uint32_t i = 0; i < file.nfuncs; i++) {
+        if (!quadfile_function(&file, i, &buf)) {
+            errs() << path << ": block " << i << " is damaged\n";
+            quadfile_unmap(&file);
+            return 0;
+        }
+        bitcodegenQuads(&buf);
+    }
+    quadfile_unmap(&file);
+    if (quadFailed)
+        return 0;
+    OutputModule();
+    return 1;
+}
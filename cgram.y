@@ -7,13 +7,23 @@
 #include "./semutil.h"
 #include "./sem.h"
 #include "./sym.h"
+#include "./quadbuf.h"
+#include "./quadfile.h"
+#include "./scanner.h"
 #else
 #include "../cc.h"
 #include "../scan.h"
 #include "../semutil.h"
 #include "../sem.h"
 #include "../sym.h"
+#include "../quadbuf.h"
+#include "../quadfile.h"
+#include "../scanner.h"
 #endif
+
+struct sem_rec *newNode(int place, int mode, struct sem_rec *p1, struct sem_rec *p2);
+struct id_entry *vardcl(struct id_entry *p, int type);
+extern int numberEachFunction;
 %}
 
 %union {
@@ -57,8 +67,8 @@ dcls    :			{}
         | dcls dcl ';'		{}
         ;
 
-dcl     : type dclr             { $$ = dcl($2, $1, 0); }
-        | dcl ',' dclr          { $$ = dcl($3, $1->i_type&~T_ARRAY, 0); }
+dcl     : type dclr             { $$ = vardcl($2, $1); }
+        | dcl ',' dclr          { $$ = vardcl($3, $1->i_type&~T_ARRAY); }
         ;
 
 dclr    : ID                    { $$ = dclr($1, 0, 1); }
@@ -143,7 +153,7 @@ stmt    : expr ';'
                 { }
         ;
 
-cexpro  :			{ $$ = node(0, 0, n(), 0); }
+cexpro  :			{ $$ = newNode(0, 0, n(), 0); }
         | cexpr			{}
         ;
 
@@ -206,27 +216,182 @@ lval	: ID			{ $$ = id($1); }
 %%
 # include <stdio.h>
 # include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# include <sys/wait.h>
 extern int lineno;
 
+static int parseJobs(int jobs);
+
+#ifdef BITCODEGEN
+void bitcodegenInit(void);
+int bitcodegenFinish(void);
+int bitcodegenQuadFile(const char *path);
+#endif
+
 /* 
  * main - read a program, and parse it
+ * Built with -DBITCODEGEN, the quads go straight to the bitcode generator
+ * and the module is printed instead; -r file compiles a binary quad file
+ * without parsing. -b file writes the quads to a binary quad file rather
+ * than printing them, and -q prints the quads as text in either build.
+ * The quadopt passes run by default only where the quads are consumed, in
+ * the bitcode generator or a binary quad file, so the text is unchanged;
+ * -O runs them on the text too, and -u leaves the quads as the actions
+ * made them. -e also runs calls to pure functions with constant arguments
+ * where the passes run, and puts in what they return.
+ * -j n parses with n forked front ends, each translating its own run of
+ * functions.
  */
 int main(int argc, char *argv[])
 {
    int yyparse();
+   char *binName = NULL, *readName = NULL;
+   int dump = 0, jobs = 1, opt = -1, i;
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+         binName = argv[++i];
+      else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+         readName = argv[++i];
+      else if (strcmp(argv[i], "-q") == 0)
+         dump = 1;
+      else if (strcmp(argv[i], "-O") == 0)
+         opt = 1;
+      else if (strcmp(argv[i], "-u") == 0)
+         opt = 0;
+      else if (strcmp(argv[i], "-e") == 0)
+         quad_eval = 1;
+      else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+         jobs = atoi(argv[++i]);
+   }
+
+#ifdef BITCODEGEN
+   quad_opt = opt != 0;
+#else
+   quad_opt = opt > 0 || (opt < 0 && binName);
+#endif
+
+#ifdef BITCODEGEN
+   if (readName)
+      exit(bitcodegenQuadFile(readName) ? 0 : 1);
+   if (!binName)
+      bitcodegenInit();
+#endif
+   if (binName && !quadfile_create(binName))
+      exit(1);
+   if (dump)
+      quad_text = 1;
 
    enterblock();
    initlex();
    enterblock();
-   if (yyparse())
+   if (jobs > 1) {
+      if (!parseJobs(jobs))
+         exit(1);
+   } else if (yyparse()) {
       yyerror("syntax error");
+      exit(1);
+   }
+   quad_flush();
+   if (binName)
+      quadfile_close();
+#ifdef BITCODEGEN
+   else if (!bitcodegenFinish())
+      exit(1);
+#endif
    exit(0);
 }
 
 /*
- * yyerror - issue error message
+ * parseJobs - split the functions into jobs runs of about equal size and
+ * parse the whole source once per run in a forked front end. Each skips the
+ * bodies outside its run and keeps only their quads, which it writes to a
+ * binary quad file in TMPDIR; the files are then handed on in order, so the
+ * result is the same as one parse. The runs number the temps and labels of
+ * each function from 1, so none depends on the ones before it, and
+ * quad_deliver numbers them on from the functions before. Every run sees
+ * the globals, but each error is reported by the run that keeps its quads.
+ */
+static int parseJobs(int jobs)
+{
+   struct scan_body *bodies;
+   const char *tmpdir = getenv("TMPDIR");
+   char **paths;
+   pid_t *pids;
+   long total = 0, size = 0;
+   int n, k, first = 0, last, status, ok = 1;
+
+   n = scan_bodies(&bodies);
+   if (jobs > n)
+      jobs = n > 0 ? n : 1;
+   for (k = 0; k < n; k++)
+      total += bodies[k].end - bodies[k].start;
+   if (tmpdir == NULL || *tmpdir == '\0')
+      tmpdir = "/tmp";
+   paths = malloc(jobs * sizeof(*paths));
+   pids = malloc(jobs * sizeof(*pids));
+   for (k = 0; paths != NULL && k < jobs; k++)
+      if ((paths[k] = malloc(strlen(tmpdir) + sizeof("/cquadsXXXXXX"))) == NULL)
+         break;
+   if (paths == NULL || pids == NULL || k < jobs) {
+      fprintf(stderr, "out of memory\n");
+      return 0;
+   }
+
+   fflush(stdout);
+   fflush(stderr);
+   for (k = 0; k < jobs; k++) {
+      /* the last run also takes the globals after the last function */
+      for (last = first; last < n && (k == jobs - 1 || size < total / jobs * (k + 1)); last++)
+         size += bodies[last].end - bodies[last].start;
+      if (k == jobs - 1)
+         last = n + 1;
+
+      sprintf(paths[k], "%s/cquadsXXXXXX", tmpdir);
+      if ((status = mkstemp(paths[k])) == -1 || (pids[k] = fork()) == -1) {
+         fprintf(stderr, "could not start front end %d\n", k);
+         exit(1);
+      }
+      close(status);
+      if (pids[k] == 0) {
+         quad_from = first;
+         quad_to = last;
+         quad_eval = 0;      /* the functions before the run are not seen */
+         numberEachFunction = 1;
+         scan_skip(bodies, n, first, last);
+         if (!quadfile_create(paths[k]))
+            _exit(1);
+         if (yyparse()) {
+            yyerror("syntax error");
+            _exit(1);
+         }
+         quad_flush();
+         quadfile_close();
+         _exit(0);
+      }
+      first = last;
+   }
+
+   for (k = 0; k < jobs; k++) {
+      if (waitpid(pids[k], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+         ok = 0;
+      else if (ok && !quadfile_replay(paths[k], quad_deliver))
+         ok = 0;
+      unlink(paths[k]);
+      free(paths[k]);
+   }
+   free(paths);
+   free(pids);
+   return ok;
+}
+
+/*
+ * yyerror - issue error message, unless another run of parseJobs keeps
+ * the quads it is about
  */
 void yyerror(char msg[])
 {
-   fprintf(stderr, " %s.  Line %d\n", msg, lineno);
+   if (quad_kept())
+      fprintf(stderr, " %s.  Line %d\n", msg, lineno);
 }
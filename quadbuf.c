@@ -0,0 +1,486 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <limits.h>
+# include "sym.h"
+# include "quadbuf.h"
+# include "quadopt.h"
+
+int quad_text = 1;
+int quad_opt = 0;
+int quad_eval = 0;
+int quad_from = 0;
+int quad_to = INT_MAX;
+
+static struct quad_buffer current;
+static quad_consumer consumer = NULL;
+static int flushes = 0;
+
+static int intern(const char *s);
+static struct quad *emit(int op);
+static void done(struct quad *q);
+static void renumber(struct quad_buffer *buf);
+
+/*
+ * quad_set_consumer - hand each function's quads to fn instead of printing
+ * them; quad_text may be set again afterwards to keep the text dump
+ */
+void quad_set_consumer(quad_consumer fn) {
+    consumer = fn;
+    quad_text = 0;
+}
+
+/*
+ * quad_flush - pass the buffered quads to the consumer and start over
+ * Called at the end of each function, and once more at the end of the
+ * input for globals declared after the last function. With quad_opt set,
+ * the passes run first and the text is printed here, once they are done;
+ * with quad_eval set too, so does quad_eval_calls.
+ * Flushes are counted from 0, and one outside [quad_from, quad_to) is
+ * dropped unseen.
+ */
+void quad_flush() {
+    int i, keep = flushes >= quad_from && flushes < quad_to;
+
+    flushes++;
+    if (keep && quad_opt) {
+        quad_optimize(&current);
+        if (quad_eval)
+            quad_eval_calls(&current);
+        for (i = 0; quad_text && i < current.nquads; i++)
+            quad_print(stdout, &current, &current.quads[i]);
+    }
+    if (keep && consumer && current.nquads > 0)
+        consumer(&current);
+    current.nquads = 0;
+    current.nargs = 0;
+    current.nnames = 0;
+}
+
+/*
+ * quad_kept - whether the quads being made now will be kept by their flush
+ */
+int quad_kept() {
+    return flushes >= quad_from && flushes < quad_to;
+}
+
+/*
+ * quad_deliver - print and hand on one function's finished quads as
+ * quad_flush would, for quads that were made and flushed by a forked front
+ * end, numbered on their own and without quad_eval. On a copy, the temps
+ * and labels are moved to where one parse would have numbered them, and
+ * the calls are evaluated.
+ */
+void quad_deliver(const struct quad_buffer *buf) {
+    static struct quad_buffer copy;
+    int i;
+
+    copy.quads = quad_grow(copy.quads, &copy.maxquads, buf->nquads, sizeof(struct quad));
+    copy.args = quad_grow(copy.args, &copy.maxargs, buf->nargs, sizeof(int));
+    copy.names = quad_grow(copy.names, &copy.maxnames, buf->nnames, 1);
+    memcpy(copy.quads, buf->quads, buf->nquads * sizeof(struct quad));
+    memcpy(copy.args, buf->args, buf->nargs * sizeof(int));
+    memcpy(copy.names, buf->names, buf->nnames);
+    copy.nquads = buf->nquads;
+    copy.nargs = buf->nargs;
+    copy.nnames = buf->nnames;
+    buf = &copy;
+
+    renumber(&copy);
+    if (quad_opt && quad_eval)
+        quad_eval_calls(&copy);
+
+    for (i = 0; quad_text && i < buf->nquads; i++)
+        quad_print(stdout, buf, &buf->quads[i]);
+    if (consumer && buf->nquads > 0)
+        consumer(buf);
+}
+
+/*
+ * renumber - add the temps and labels of the functions delivered before to
+ * every temp and label of buf; each fend tells how many its function made
+ */
+static void renumber(struct quad_buffer *buf) {
+    static int temps = 0, labels = 0, blanks = 0;
+    struct quad *q;
+    int i;
+
+    for (q = buf->quads; q < buf->quads + buf->nquads; q++) {
+        if (q->dst)
+            q->dst += temps;
+        switch (q->op) {
+            case Q_BINOP:
+            case Q_INDEX:
+            case Q_STORE:
+                q->b += temps;
+                /* fall through */
+            case Q_UNARY:
+            case Q_CV:
+            case Q_ARG:
+                q->a += temps;
+                break;
+            case Q_CALL:
+                q->a += temps;
+                for (i = 0; i < q->num; i++)
+                    buf->args[q->b + i] += temps;
+                break;
+            case Q_RET:
+                if (q->a >= 0)
+                    q->a += temps;
+                break;
+            case Q_BT:
+                q->a += temps;
+                /* fall through */
+            case Q_BR:
+                q->label += q->blank ? blanks : labels;
+                break;
+            case Q_LABEL:
+                q->label += labels;
+                break;
+            case Q_PATCH:
+                q->label += blanks;
+                q->num += labels;
+                break;
+            case Q_FEND:
+                q->a = temps += q->a;
+                q->label = labels += q->label;
+                q->num = blanks += q->num;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+const char *quad_name(const struct quad_buffer *buf, const struct quad *q) {
+    return q->name < 0 ? NULL : buf->names + q->name;
+}
+
+const int *quad_args(const struct quad_buffer *buf, const struct quad *q) {
+    return buf->args + q->b;
+}
+
+/*
+ * quad_print - print a quad in the original text format
+ */
+void quad_print(FILE *out, const struct quad_buffer *buf, const struct quad *q) {
+    const char *name = quad_name(buf, q);
+    int i;
+
+    switch (q->op) {
+        case Q_BGNSTMT:
+            fprintf(out, "bgnstmt %d\n", q->num);
+            break;
+        case Q_GLOBAL_ALLOC:
+            fprintf(out, "alloc %s %d\n", name, q->size);
+            break;
+        case Q_FUNC:
+            fprintf(out, "func %s %d\n", name, q->num);
+            break;
+        case Q_FORMAL:
+            fprintf(out, "formal %s %d %d\n", name, q->num, q->size);
+            break;
+        case Q_LOCALLOC:
+            fprintf(out, "localloc %s %d %d\n", name, q->num, q->size);
+            break;
+        case Q_FEND:
+            fprintf(out, "fend\n");
+            break;
+        case Q_CON:
+        case Q_STR:
+            fprintf(out, "t%d := %s\n", q->dst, name);
+            break;
+        case Q_GLOBAL_REF:
+            fprintf(out, "t%d := global %s\n", q->dst, name);
+            break;
+        case Q_LOCAL_REF:
+            fprintf(out, "t%d := local %s %d\n", q->dst, name, q->num);
+            break;
+        case Q_PARAM_REF:
+            fprintf(out, "t%d := param %s %d\n", q->dst, name, q->num);
+            break;
+        case Q_UNARY:
+            fprintf(out, "t%d := %s%c t%d\n", q->dst, q->oper, q->type, q->a);
+            break;
+        case Q_CV:
+            fprintf(out, "t%d := cv%c t%d\n", q->dst, q->type, q->a);
+            break;
+        case Q_BINOP:
+            fprintf(out, "t%d := t%d %s%c t%d\n", q->dst, q->a, q->oper, q->type, q->b);
+            break;
+        case Q_INDEX:
+            fprintf(out, "t%d := t%d []%c t%d\n", q->dst, q->a, q->type, q->b);
+            break;
+        case Q_STORE:
+            fprintf(out, "t%d := t%d =%c t%d\n", q->dst, q->a, q->type, q->b);
+            break;
+        case Q_ARG:
+            fprintf(out, "arg%c t%d\n", q->type, q->a);
+            break;
+        case Q_CALL:
+            fprintf(out, "t%d := f%c t%d %d", q->dst, q->type, q->a, q->num);
+            for (i = 0; i < q->num; i++)
+                fprintf(out, " t%d", quad_args(buf, q)[i]);
+            fprintf(out, "\n");
+            break;
+        case Q_LABEL:
+            fprintf(out, "label L%d\n", q->label);
+            break;
+        case Q_BR:
+            fprintf(out, "br %c%d\n", q->blank ? 'B' : 'L', q->label);
+            break;
+        case Q_BT:
+            fprintf(out, "bt t%d %c%d\n", q->a, q->blank ? 'B' : 'L', q->label);
+            break;
+        case Q_PATCH:
+            fprintf(out, "B%d=L%d\n", q->label, q->num);
+            break;
+        case Q_RET:
+            if (q->a < 0)
+                fprintf(out, "ret%c\n", q->type);
+            else
+                fprintf(out, "ret%c t%d\n", q->type, q->a);
+            break;
+    }
+}
+
+/*
+ * quad constructors - one per quad form; each appends a typed record to the
+ * current function's buffer and, with quad_text set and quad_opt clear,
+ * prints it right away so the text keeps its place among any other output
+ * of the front end
+ */
+void quad_bgnstmt(int line) {
+    struct quad *q = emit(Q_BGNSTMT);
+    q->num = line;
+    done(q);
+}
+
+void quad_global(const char *name, int type, int size, int elems) {
+    struct quad *q = emit(Q_GLOBAL_ALLOC);
+    q->name = intern(name);
+    q->num = type;
+    q->size = size;
+    q->a = elems;
+    done(q);
+}
+
+void quad_func(const char *name, int type) {
+    struct quad *q = emit(Q_FUNC);
+    q->name = intern(name);
+    q->num = type;
+    done(q);
+}
+
+void quad_formal(const char *name, int type, int size) {
+    struct quad *q = emit(Q_FORMAL);
+    q->name = intern(name);
+    q->num = type;
+    q->size = size;
+    done(q);
+}
+
+void quad_localloc(const char *name, int type, int size, int elems) {
+    struct quad *q = emit(Q_LOCALLOC);
+    q->name = intern(name);
+    q->num = type;
+    q->size = size;
+    q->a = elems;
+    done(q);
+}
+
+void quad_fend(int temps, int labels, int blanks) {
+    struct quad *q = emit(Q_FEND);
+    q->a = temps;
+    q->label = labels;
+    q->num = blanks;
+    done(q);
+}
+
+void quad_con(int dst, const char *text) {
+    struct quad *q = emit(Q_CON);
+    q->dst = dst;
+    q->name = intern(text);
+    done(q);
+}
+
+void quad_str(int dst, const char *text) {
+    struct quad *q = emit(Q_STR);
+    q->dst = dst;
+    q->name = intern(text);
+    done(q);
+}
+
+void quad_ref(int dst, int scope, const char *name, int offset) {
+    struct quad *q = emit(scope == LOCAL ? Q_LOCAL_REF :
+                          scope == PARAM ? Q_PARAM_REF : Q_GLOBAL_REF);
+    q->dst = dst;
+    q->name = intern(name);
+    q->num = offset;
+    done(q);
+}
+
+void quad_unary(int dst, const char *oper, char type, int a) {
+    struct quad *q = emit(Q_UNARY);
+    q->dst = dst;
+    strncpy(q->oper, oper, sizeof(q->oper) - 1);
+    q->type = type;
+    q->a = a;
+    done(q);
+}
+
+void quad_cv(int dst, char type, int a) {
+    struct quad *q = emit(Q_CV);
+    q->dst = dst;
+    q->type = type;
+    q->a = a;
+    done(q);
+}
+
+void quad_binop(int dst, int a, const char *oper, char type, int b) {
+    struct quad *q = emit(Q_BINOP);
+    q->dst = dst;
+    q->a = a;
+    strncpy(q->oper, oper, sizeof(q->oper) - 1);
+    q->type = type;
+    q->b = b;
+    done(q);
+}
+
+void quad_index(int dst, int a, char type, int b) {
+    struct quad *q = emit(Q_INDEX);
+    q->dst = dst;
+    q->a = a;
+    q->type = type;
+    q->b = b;
+    done(q);
+}
+
+void quad_store(int dst, int a, char type, int b) {
+    struct quad *q = emit(Q_STORE);
+    q->dst = dst;
+    q->a = a;
+    q->type = type;
+    q->b = b;
+    done(q);
+}
+
+void quad_arg(char type, int a) {
+    struct quad *q = emit(Q_ARG);
+    q->type = type;
+    q->a = a;
+    done(q);
+}
+
+void quad_call(int dst, char type, int fn, int nargs, const int *args) {
+    struct quad *q = emit(Q_CALL);
+    int i;
+
+    current.args = quad_grow(current.args, &current.maxargs, current.nargs + nargs, sizeof(int));
+    q->dst = dst;
+    q->type = type;
+    q->a = fn;
+    q->num = nargs;
+    q->b = current.nargs;
+    for (i = 0; i < nargs; i++)
+        current.args[current.nargs++] = args[i];
+    done(q);
+}
+
+void quad_label(int label) {
+    struct quad *q = emit(Q_LABEL);
+    q->label = label;
+    done(q);
+}
+
+void quad_br(int blank, int label) {
+    struct quad *q = emit(Q_BR);
+    q->blank = (char) blank;
+    q->label = label;
+    done(q);
+}
+
+void quad_bt(int a, int label) {
+    struct quad *q = emit(Q_BT);
+    q->a = a;
+    q->blank = 1;
+    q->label = label;
+    done(q);
+}
+
+void quad_patch(int blank, int label) {
+    struct quad *q = emit(Q_PATCH);
+    q->label = blank;
+    q->num = label;
+    done(q);
+}
+
+void quad_ret(char type, int a) {
+    struct quad *q = emit(Q_RET);
+    q->type = type;
+    q->a = a;
+    done(q);
+}
+
+/*
+ * emit - start a new quad at the end of the buffer
+ * Without a consumer or the passes nothing is kept, so a text-only run
+ * reuses one slot.
+ */
+static struct quad *emit(int op) {
+    struct quad *q;
+
+    if (!consumer && !quad_opt)
+        current.nquads = 0;
+    current.quads = quad_grow(current.quads, &current.maxquads, current.nquads + 1, sizeof(struct quad));
+    q = &current.quads[current.nquads];
+    memset(q, 0, sizeof(*q));
+    q->op = (unsigned char) op;
+    q->name = -1;
+    return q;
+}
+
+/*
+ * done - keep the finished quad, printing it first if asked to and no
+ * pass is going to change it
+ */
+static void done(struct quad *q) {
+    if (quad_text && !quad_opt)
+        quad_print(stdout, &current, q);
+    if (consumer || quad_opt)
+        current.nquads++;
+    else
+        current.nargs = current.nnames = 0;
+}
+
+/*
+ * intern - copy a name into the buffer's string pool, returning its offset
+ */
+static int intern(const char *s) {
+    int len = (int) strlen(s) + 1;
+    int offset = current.nnames;
+
+    current.names = quad_grow(current.names, &current.maxnames, current.nnames + len, 1);
+    memcpy(current.names + offset, s, len);
+    current.nnames += len;
+    return offset;
+}
+
+/*
+ * quad_grow - make room for need elements of size bytes, doubling the
+ * capacity; the front end grows all its arrays with it
+ */
+void *quad_grow(void *data, int *max, int need, size_t size) {
+    if (need <= *max)
+        return data;
+
+    int newMax = *max ? *max : 64;
+    while (newMax < need)
+        newMax *= 2;
+    if ((data = realloc(data, newMax * size)) == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    *max = newMax;
+    return data;
+}
@@ -0,0 +1,111 @@
+#ifndef QUADBUF_H
+#define QUADBUF_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * quad_op - one opcode per quadruple form printed by the front end
+ */
+enum quad_op {
+    Q_BGNSTMT,      /* bgnstmt N             num = line                       */
+    Q_GLOBAL_ALLOC, /* alloc NAME SIZE       name, num = type, size, a = elems */
+    Q_FUNC,         /* func NAME TYPE        name, num = type                 */
+    Q_FORMAL,       /* formal NAME TYPE SIZE name, num = type, size           */
+    Q_LOCALLOC,     /* localloc NAME TYPE SIZE  name, num = type, size, a = elems */
+    Q_FEND,         /* fend                  a, label, num = temps, L and B labels made so far */
+    Q_CON,          /* tD := CON             name = constant text             */
+    Q_STR,          /* tD := "STR"           name = string text               */
+    Q_GLOBAL_REF,   /* tD := global NAME                                      */
+    Q_LOCAL_REF,    /* tD := local NAME OFF  num = offset                     */
+    Q_PARAM_REF,    /* tD := param NAME OFF  num = offset                     */
+    Q_UNARY,        /* tD := OPc tA          oper is "@", "-" or "~"          */
+    Q_CV,           /* tD := cvc tA                                           */
+    Q_BINOP,        /* tD := tA OPc tB       arithmetic, bitwise, relational  */
+    Q_INDEX,        /* tD := tA []c tB                                        */
+    Q_STORE,        /* tD := tA =c tB                                         */
+    Q_ARG,          /* argc tA                                                */
+    Q_CALL,         /* tD := fc tA N args    num = N, b = first arg in args   */
+    Q_LABEL,        /* label LN              label = N                        */
+    Q_BR,           /* br LN / br BN         label = N, blank set for BN      */
+    Q_BT,           /* bt tA BN / bt tA LN   label = N, blank set for BN      */
+    Q_PATCH,        /* BN=LK                 label = N, num = K               */
+    Q_RET           /* retc [tA]             a = -1 without a value           */
+};
+
+/*
+ * quad - a typed quadruple; temps and labels are numbers, names are offsets
+ * into the owning buffer's string pool (-1 when the quad has none)
+ */
+struct quad {
+    unsigned char op;           /* enum quad_op */
+    char type;                  /* 'i' or 'f' suffix, 0 when printed without one */
+    char oper[3];               /* operator text of Q_UNARY and Q_BINOP */
+    char blank;                 /* the branch target is a B (backpatch) label */
+    int dst;                    /* result temp */
+    int a, b;                   /* operand temps (see quad_op for other uses) */
+    int label;                  /* L or B label number */
+    int num;                    /* line, type, offset, argument count, or L label */
+    int size;                   /* width in bytes of an allocation */
+    int name;                   /* offset of the name in the string pool */
+};
+
+/*
+ * quad_buffer - the quads of one function, with the call arguments and
+ * names they refer to
+ */
+struct quad_buffer {
+    struct quad *quads;
+    int nquads, maxquads;
+    int *args;
+    int nargs, maxargs;
+    char *names;
+    int nnames, maxnames;
+};
+
+typedef void (*quad_consumer)(const struct quad_buffer *);
+
+extern int quad_text;           /* print each quad as text as it is made */
+extern int quad_opt;            /* run the quadopt passes over each function first */
+extern int quad_eval;           /* and evaluate calls to pure functions, with quad_opt */
+extern int quad_from, quad_to;  /* flushes kept; the others are dropped */
+
+void quad_set_consumer(quad_consumer fn);
+void quad_flush(void);
+int quad_kept(void);
+void quad_deliver(const struct quad_buffer *buf);
+void quad_print(FILE *out, const struct quad_buffer *buf, const struct quad *q);
+const char *quad_name(const struct quad_buffer *buf, const struct quad *q);
+const int *quad_args(const struct quad_buffer *buf, const struct quad *q);
+void *quad_grow(void *data, int *max, int need, size_t size);
+
+void quad_bgnstmt(int line);
+void quad_global(const char *name, int type, int size, int elems);
+void quad_func(const char *name, int type);
+void quad_formal(const char *name, int type, int size);
+void quad_localloc(const char *name, int type, int size, int elems);
+void quad_fend(int temps, int labels, int blanks);
+void quad_con(int dst, const char *text);
+void quad_str(int dst, const char *text);
+void quad_ref(int dst, int scope, const char *name, int offset);
+void quad_unary(int dst, const char *oper, char type, int a);
+void quad_cv(int dst, char type, int a);
+void quad_binop(int dst, int a, const char *oper, char type, int b);
+void quad_index(int dst, int a, char type, int b);
+void quad_store(int dst, int a, char type, int b);
+void quad_arg(char type, int a);
+void quad_call(int dst, char type, int fn, int nargs, const int *args);
+void quad_label(int label);
+void quad_br(int blank, int label);
+void quad_bt(int a, int label);
+void quad_patch(int blank, int label);
+void quad_ret(char type, int a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,268 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <limits.h>
+# include <string.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include "quadfile.h"
+
+static FILE *out = NULL;
+static uint64_t *table = NULL;
+static uint32_t nfuncs = 0, maxfuncs = 0;
+
+static void writefunc(const struct quad_buffer *buf);
+static void put(const void *data, size_t size);
+static int checkfunc(const struct quad_buffer *buf);
+
+/*
+ * quadfile_create - start a binary quad file; every function the front end
+ * finishes is appended to it until quadfile_close
+ */
+int quadfile_create(const char *path) {
+    struct quadfile_header header;
+
+    if ((out = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "could not open %s\n", path);
+        return 0;
+    }
+    memset(&header, 0, sizeof(header));
+    put(&header, sizeof(header));           /* filled in by quadfile_close */
+    nfuncs = 0;
+    quad_set_consumer(writefunc);
+    return 1;
+}
+
+/*
+ * quadfile_close - write the function table and the header
+ */
+void quadfile_close() {
+    struct quadfile_header header;
+
+    if (out == NULL)
+        return;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, QUADFILE_MAGIC, sizeof(header.magic));
+    header.version = QUADFILE_VERSION;
+    header.quad_size = sizeof(struct quad);
+    header.nfuncs = nfuncs;
+    header.table = (uint64_t) ftell(out);
+    put(table, nfuncs * sizeof(*table));
+
+    fseek(out, 0, SEEK_SET);
+    put(&header, sizeof(header));
+    fclose(out);
+    out = NULL;
+    free(table);
+    table = NULL;
+}
+
+/*
+ * writefunc - append one function's block, as the quad consumer
+ */
+static void writefunc(const struct quad_buffer *buf) {
+    static const char zeros[8];
+    struct quadfile_func func;
+    size_t used;
+
+    if (nfuncs == maxfuncs) {
+        maxfuncs = maxfuncs ? maxfuncs * 2 : 64;
+        if ((table = realloc(table, maxfuncs * sizeof(*table))) == NULL) {
+            fprintf(stderr, "out of memory for quads\n");
+            exit(1);
+        }
+    }
+    table[nfuncs++] = (uint64_t) ftell(out);
+
+    memset(&func, 0, sizeof(func));
+    func.nquads = buf->nquads;
+    func.nargs = buf->nargs;
+    func.nnames = buf->nnames;
+    put(&func, sizeof(func));
+    put(buf->quads, buf->nquads * sizeof(struct quad));
+    put(buf->args, buf->nargs * sizeof(int));
+    put(buf->names, buf->nnames);
+
+    used = sizeof(func) + buf->nquads * sizeof(struct quad) + buf->nargs * sizeof(int) + buf->nnames;
+    put(zeros, (8 - used % 8) % 8);
+}
+
+static void put(const void *data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, out) != size) {
+        fprintf(stderr, "could not write quads\n");
+        exit(1);
+    }
+}
+
+/*
+ * quadfile_map - map a binary quad file read-only and check its header
+ */
+int quadfile_map(const char *path, struct quad_file *f) {
+    const struct quadfile_header *header;
+    struct stat info;
+    void *map;
+    int fd;
+
+    memset(f, 0, sizeof(*f));
+    if ((fd = open(path, O_RDONLY)) == -1 || fstat(fd, &info) == -1) {
+        fprintf(stderr, "could not open %s\n", path);
+        if (fd != -1)
+            close(fd);
+        return 0;
+    }
+    if ((size_t) info.st_size < sizeof(*header)) {
+        fprintf(stderr, "%s is not a quad file\n", path);
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "could not map %s\n", path);
+        return 0;
+    }
+
+    f->map = map;
+    f->size = (size_t) info.st_size;
+    header = (const struct quadfile_header *) f->map;
+    if (memcmp(header->magic, QUADFILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != QUADFILE_VERSION || header->quad_size != sizeof(struct quad) ||
+        header->table > f->size || (f->size - header->table) / sizeof(uint64_t) < header->nfuncs) {
+        fprintf(stderr, "%s is not a quad file of this version\n", path);
+        quadfile_unmap(f);
+        return 0;
+    }
+    f->nfuncs = header->nfuncs;
+    f->table = (const uint64_t *) (f->map + header->table);
+    return 1;
+}
+
+/*
+ * quadfile_function - point buf at function i of the mapping; the quads,
+ * arguments and names are used where they lie and must not be changed
+ */
+int quadfile_function(const struct quad_file *f, uint32_t i, struct quad_buffer *buf) {
+    const struct quadfile_func *func;
+    uint64_t offset;
+
+    /* blocks start 8-byte aligned, and no count is added to an offset before it is bounded */
+    if (i >= f->nfuncs || (offset = f->table[i]) % 8 != 0 || offset > f->size ||
+        f->size - offset < sizeof(*func))
+        return 0;
+    func = (const struct quadfile_func *) (f->map + offset);
+    if (func->nquads > INT_MAX || func->nargs > INT_MAX || func->nnames > INT_MAX ||
+        f->size - offset - sizeof(*func) < (uint64_t) func->nquads * sizeof(struct quad) +
+                                            (uint64_t) func->nargs * sizeof(int) + func->nnames)
+        return 0;
+
+    buf->quads = (struct quad *) (func + 1);
+    buf->nquads = buf->maxquads = (int) func->nquads;
+    buf->args = (int *) (buf->quads + func->nquads);
+    buf->nargs = buf->maxargs = (int) func->nargs;
+    buf->names = (char *) (buf->args + func->nargs);
+    buf->nnames = buf->maxnames = (int) func->nnames;
+    return checkfunc(buf);
+}
+
+/*
+ * checkfunc - check that every name, argument, temp and L label a block's
+ * quads refer to lies inside the block. A B label may go unpatched, as
+ * for a goto to a label that is never declared.
+ */
+static int checkfunc(const struct quad_buffer *buf) {
+    const struct quad *q, *end = buf->quads + buf->nquads;
+    int minTemp = INT_MAX, maxTemp = 0, minLabel = INT_MAX, maxLabel = 0, i;
+
+    /* the pool ends in a NUL, so every name in it is terminated */
+    if (buf->nnames > 0 && buf->names[buf->nnames - 1] != '\0')
+        return 0;
+    for (q = buf->quads; q < end; q++) {
+        if (q->op > Q_RET || q->name < -1 || q->name >= buf->nnames)
+            return 0;
+        if (q->name == -1 && (q->op == Q_GLOBAL_ALLOC || q->op == Q_FUNC || q->op == Q_FORMAL ||
+                              q->op == Q_LOCALLOC || (q->op >= Q_CON && q->op <= Q_PARAM_REF)))
+            return 0;
+        if (q->dst) {
+            minTemp = q->dst < minTemp ? q->dst : minTemp;
+            maxTemp = q->dst > maxTemp ? q->dst : maxTemp;
+        }
+        if (q->op == Q_LABEL) {
+            minLabel = q->label < minLabel ? q->label : minLabel;
+            maxLabel = q->label > maxLabel ? q->label : maxLabel;
+        }
+    }
+
+#define TEMP(t) ((t) >= minTemp && (t) <= maxTemp)
+#define LABEL(l) ((l) >= minLabel && (l) <= maxLabel)
+    for (q = buf->quads; q < end; q++) {
+        switch (q->op) {
+            case Q_BINOP:
+            case Q_INDEX:
+            case Q_STORE:
+                if (!TEMP(q->b))
+                    return 0;
+                /* fall through */
+            case Q_UNARY:
+            case Q_CV:
+            case Q_ARG:
+                if (!TEMP(q->a))
+                    return 0;
+                break;
+            case Q_CALL:
+                if (!TEMP(q->a) || q->b < 0 || q->num < 0 || q->num > buf->nargs - q->b)
+                    return 0;
+                for (i = 0; i < q->num; i++)
+                    if (!TEMP(buf->args[q->b + i]))
+                        return 0;
+                break;
+            case Q_BR:
+            case Q_BT:
+                if ((q->op == Q_BT && !TEMP(q->a)) || (!q->blank && !LABEL(q->label)))
+                    return 0;
+                break;
+            case Q_PATCH:
+                if (!LABEL(q->num))
+                    return 0;
+                break;
+            case Q_RET:
+                if (q->a != -1 && !TEMP(q->a))
+                    return 0;
+                break;
+            default:
+                break;
+        }
+    }
+#undef TEMP
+#undef LABEL
+    return 1;
+}
+
+/*
+ * quadfile_replay - hand each function of a quad file to fn, in order
+ */
+int quadfile_replay(const char *path, quad_consumer fn) {
+    struct quad_file f;
+    struct quad_buffer buf;
+    uint32_t i;
+
+    if (!quadfile_map(path, &f))
+        return 0;
+    for (i = 0; i < f.nfuncs; i++) {
+        if (!quadfile_function(&f, i, &buf)) {
+            fprintf(stderr, "%s: block %u is damaged\n", path, i);
+            quadfile_unmap(&f);
+            return 0;
+        }
+        fn(&buf);
+    }
+    quadfile_unmap(&f);
+    return 1;
+}
+
+void quadfile_unmap(struct quad_file *f) {
+    if (f->map)
+        munmap((void *) f->map, f->size);
+    memset(f, 0, sizeof(*f));
+}
@@ -0,0 +1,61 @@
+#ifndef QUADFILE_H
+#define QUADFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "quadbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary quad files. The layout is
+ *
+ *   quadfile_header
+ *   one block per function: quadfile_func, its quads, its call arguments
+ *     and its string pool, padded to a multiple of 8 bytes
+ *   the function table: nfuncs 64-bit block offsets
+ *
+ * Quads are stored exactly as struct quad, with their names as offsets into
+ * the block's own pool, so a mapped block is used in place as a quad_buffer.
+ */
+#define QUADFILE_MAGIC "CSQ"
+#define QUADFILE_VERSION 1
+
+struct quadfile_header {
+    char magic[3];
+    char version;
+    uint32_t quad_size;         /* sizeof(struct quad) of the writer */
+    uint32_t nfuncs;
+    uint32_t reserved;
+    uint64_t table;             /* file offset of the function table */
+};
+
+struct quadfile_func {
+    uint32_t nquads;
+    uint32_t nargs;
+    uint32_t nnames;
+    uint32_t reserved;
+};
+
+struct quad_file {
+    const char *map;
+    size_t size;
+    uint32_t nfuncs;
+    const uint64_t *table;
+};
+
+int quadfile_create(const char *path);
+void quadfile_close(void);
+
+int quadfile_map(const char *path, struct quad_file *f);
+int quadfile_function(const struct quad_file *f, uint32_t i, struct quad_buffer *buf);
+int quadfile_replay(const char *path, quad_consumer fn);
+void quadfile_unmap(struct quad_file *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1219 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <limits.h>
+# include "cc.h"
+# include "quadopt.h"
+
+#define VALUESLOTS 256
+
+/*
+ * Local value numbering. Within a block, the first temp to compute a value
+ * stands for it: a later quad computing the same value is dropped and its
+ * temp renamed to the first one. Loads are numbered through what is known of
+ * memory instead, by address temp: a store or a load tells what an address
+ * holds until a call, or for an array element a store to any element, may
+ * have changed it. Everything is forgotten at a label or a jump.
+ */
+struct value {
+    const struct quad *q;       /* the kept quad that computed it */
+    int generation;
+};
+
+struct temp {
+    int name;                   /* the temp standing for this one's value */
+    int def;                    /* index of the kept quad defining it, or -1 */
+    int uses;
+    int held;                   /* the temp holding what this address holds */
+    char heldType;
+    int memGeneration;          /* when held was learnt */
+    int elemGeneration;
+};
+
+static struct value *values = NULL;
+static int valueSlots = 0, valueCount = 0, valueGeneration = 1;
+
+static struct temp *temps = NULL;
+static int maxTemps = 0, base = 0;
+static int memGeneration = 1, elemGeneration = 1;
+
+static int setup(const struct quad_buffer *buf);
+static struct temp *info(int t);
+static void eachOperand(struct quad_buffer *buf, struct quad *q, void (*fn)(int *));
+static void canonical(int *t);
+static void count(int *t);
+static void release(int *t);
+static int pure(const struct quad *q);
+static int number(struct quad_buffer *buf, struct quad *q);
+static int indexed(const struct quad_buffer *buf, int address);
+static void newBlock(void);
+static struct value *findValue(const struct quad_buffer *buf, const struct quad *q);
+static void sweep(struct quad_buffer *buf);
+
+/*
+ * quad_optimize - run every pass over a function's quads
+ */
+void quad_optimize(struct quad_buffer *buf) {
+    quad_thread_jumps(buf);
+    quad_drop_unreachable(buf);
+    quad_thread_jumps(buf);     /* a br may now fall into its label */
+    quad_number_values(buf);
+}
+
+/*
+ * quad_number_values - drop the quads that recompute a value this block
+ * already has in a temp, then the pure quads nothing reads any more
+ */
+void quad_number_values(struct quad_buffer *buf) {
+    int r, w = 0;
+
+    if (!setup(buf))
+        return;
+    newBlock();
+    for (r = 0; r < buf->nquads; r++) {
+        struct quad *q = &buf->quads[w];
+
+        *q = buf->quads[r];
+        eachOperand(buf, q, canonical);
+        if (q->op == Q_LABEL)
+            newBlock();
+        if (!number(buf, q))
+            continue;
+        if (q->dst)
+            info(q->dst)->def = w;
+        w++;
+        if (q->op == Q_BR || q->op == Q_BT || q->op == Q_RET)
+            newBlock();
+    }
+    buf->nquads = w;
+    sweep(buf);
+}
+
+/*
+ * number - give q's result a value number; returns 0 when the value is
+ * already in a temp and q can be dropped
+ */
+static int number(struct quad_buffer *buf, struct quad *q) {
+    struct temp *t;
+    int d;
+
+    switch (q->op) {
+        case Q_UNARY:
+            if (q->oper[0] != '@')
+                break;
+            t = info(q->a);
+            if (t->memGeneration == memGeneration && t->heldType == q->type &&
+                (!indexed(buf, q->a) || t->elemGeneration == elemGeneration)) {
+                info(q->dst)->name = t->held;
+                return 0;
+            }
+            t->held = q->dst;
+            t->heldType = q->type;
+            t->memGeneration = memGeneration;
+            t->elemGeneration = elemGeneration;
+            return 1;
+        case Q_STORE:
+            if (indexed(buf, q->a))
+                elemGeneration++;
+            t = info(q->a);
+            t->held = q->b;
+            t->heldType = q->type;
+            t->memGeneration = memGeneration;
+            t->elemGeneration = elemGeneration;
+            info(q->dst)->name = q->b;  /* an assignment's value is what it stored */
+            return 1;
+        case Q_CALL:
+            memGeneration++;
+            return 1;
+        case Q_CV:
+            /* an int converted to double and back is the int */
+            d = info(q->a)->def;
+            if (q->type == 'i' && d >= 0 && buf->quads[d].op == Q_CV && buf->quads[d].type == 'f') {
+                info(q->dst)->name = buf->quads[d].a;
+                return 0;
+            }
+            break;
+        case Q_BINOP:
+            if ((strchr("+*&|^", q->oper[0]) && q->oper[1] == '\0') ||
+                strcmp(q->oper, "==") == 0 || strcmp(q->oper, "!=") == 0) {
+                if (q->a > q->b) {
+                    d = q->a;
+                    q->a = q->b;
+                    q->b = d;
+                }
+            }
+            break;
+    }
+    if (!pure(q))
+        return 1;
+
+    struct value *v = findValue(buf, q);
+    if (v->generation == valueGeneration) {
+        info(q->dst)->name = v->q->dst;
+        return 0;
+    }
+    v->q = q;
+    v->generation = valueGeneration;
+    valueCount++;
+    return 1;
+}
+
+/*
+ * indexed - whether an address is an array element, which any store to
+ * an element may change
+ */
+static int indexed(const struct quad_buffer *buf, int address) {
+    int d = info(address)->def;
+    return d < 0 || buf->quads[d].op == Q_INDEX;
+}
+
+static void newBlock() {
+    valueGeneration++;
+    valueCount = 0;
+    memGeneration++;
+}
+
+/*
+ * sweep - drop the pure quads whose temps are never read, last first so a
+ * chain of them goes at once
+ */
+static void sweep(struct quad_buffer *buf) {
+    int r, w = 0;
+
+    for (r = 0; r < buf->nquads; r++)
+        eachOperand(buf, &buf->quads[r], count);
+    for (r = buf->nquads - 1; r >= 0; r--) {
+        struct quad *q = &buf->quads[r];
+        if (pure(q) && info(q->dst)->uses == 0)
+            eachOperand(buf, q, release);
+    }
+    for (r = 0; r < buf->nquads; r++) {
+        struct quad *q = &buf->quads[r];
+        if (!(pure(q) && info(q->dst)->uses == 0))
+            buf->quads[w++] = *q;
+    }
+    buf->nquads = w;
+}
+
+/*
+ * setup - size the temp table to the temps the function defines;
+ * returns 0 when it defines none
+ */
+static int setup(const struct quad_buffer *buf) {
+    int min = 0, max = 0, i;
+
+    for (i = 0; i < buf->nquads; i++) {
+        int dst = buf->quads[i].dst;
+        if (dst > 0 && (min == 0 || dst < min))
+            min = dst;
+        if (dst > max)
+            max = dst;
+    }
+    if (max == 0)
+        return 0;
+
+    base = min;
+    temps = quad_grow(temps, &maxTemps, max - min + 1, sizeof(struct temp));
+    for (i = 0; i <= max - min; i++) {
+        memset(&temps[i], 0, sizeof(struct temp));
+        temps[i].name = base + i;
+        temps[i].def = -1;
+    }
+    return 1;
+}
+
+static struct temp *info(int t) {
+    return &temps[t - base];
+}
+
+/*
+ * eachOperand - call fn on each temp q reads
+ */
+static void eachOperand(struct quad_buffer *buf, struct quad *q, void (*fn)(int *)) {
+    int i;
+
+    switch (q->op) {
+        case Q_BINOP:
+        case Q_INDEX:
+        case Q_STORE:
+            fn(&q->b);
+            /* fall through */
+        case Q_UNARY:
+        case Q_CV:
+        case Q_ARG:
+        case Q_BT:
+            fn(&q->a);
+            break;
+        case Q_RET:
+            if (q->a >= 0)
+                fn(&q->a);
+            break;
+        case Q_CALL:
+            fn(&q->a);
+            for (i = 0; i < q->num; i++)
+                fn(&buf->args[q->b + i]);
+            break;
+    }
+}
+
+static void canonical(int *t) {
+    *t = info(*t)->name;
+}
+
+static void count(int *t) {
+    info(*t)->uses++;
+}
+
+static void release(int *t) {
+    info(*t)->uses--;
+}
+
+/*
+ * pure - whether q only computes its temp, so it can go when the temp does
+ */
+static int pure(const struct quad *q) {
+    switch (q->op) {
+        case Q_CON:
+        case Q_STR:
+        case Q_GLOBAL_REF:
+        case Q_LOCAL_REF:
+        case Q_PARAM_REF:
+        case Q_UNARY:
+        case Q_CV:
+        case Q_BINOP:
+        case Q_INDEX:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static unsigned hashQuad(const struct quad_buffer *buf, const struct quad *q) {
+    const char *s = quad_name(buf, q);
+    unsigned h = q->op;
+
+    h = h * 31 + (unsigned char) q->type;
+    h = h * 31 + (unsigned char) q->oper[0];
+    h = h * 31 + (unsigned char) q->oper[1];
+    h = h * 31 + (unsigned) q->a;
+    h = h * 31 + (unsigned) q->b;
+    h = h * 31 + (unsigned) q->num;
+    while (s && *s)
+        h = h * 33 + (unsigned char) *s++;
+    return h * 2654435761U;
+}
+
+static int sameQuad(const struct quad_buffer *buf, const struct quad *x, const struct quad *y) {
+    const char *xs = quad_name(buf, x), *ys = quad_name(buf, y);
+
+    return x->op == y->op && x->type == y->type && memcmp(x->oper, y->oper, sizeof(x->oper)) == 0 &&
+           x->a == y->a && x->b == y->b && x->num == y->num &&
+           (xs == ys || (xs && ys && strcmp(xs, ys) == 0));
+}
+
+/*
+ * findValue - the table slot of q's value, or the empty slot to put it in
+ */
+static struct value *findValue(const struct quad_buffer *buf, const struct quad *q) {
+    if (valueCount * 2 >= valueSlots) {
+        struct value *oldValues = values;
+        int oldSlots = valueSlots, i;
+
+        valueSlots = valueSlots ? 2 * valueSlots : VALUESLOTS;
+        values = calloc(valueSlots, sizeof(struct value));
+        if (values == NULL) {
+            fprintf(stderr, "out of memory for quads\n");
+            exit(1);
+        }
+        valueCount = 0;
+        for (i = 0; i < oldSlots; i++) {
+            if (oldValues[i].generation == valueGeneration) {
+                *findValue(buf, oldValues[i].q) = oldValues[i];
+                valueCount++;
+            }
+        }
+        free(oldValues);
+    }
+
+    int slot = (int) (hashQuad(buf, q) & (unsigned) (valueSlots - 1));
+    while (values[slot].generation == valueGeneration && !sameQuad(buf, values[slot].q, q))
+        slot = (slot + 1) & (valueSlots - 1);
+    return &values[slot];
+}
+
+/*
+ * Jump threading. Backpatches are resolved first, so every branch names
+ * an L label; a branch to a label whose block only jumps on is sent where
+ * that jump goes, to the end of the chain. Then a bt whose br goes to the
+ * same label leaves just the br, a br to the label it would fall into goes,
+ * and so do the labels no branch names any more.
+ */
+struct label {
+    int at;                     /* index of its label quad, or -1 */
+    int refs;
+    int thread;                 /* where a branch to it ends up, once known */
+    int reached;
+};
+
+static struct label *labels = NULL;
+static int maxLabels = 0, labelBase = 0, labelCount = 0;
+static int *patches = NULL;     /* by B label: the L label it was patched with */
+static int maxPatches = 0, patchBase = 0, patchCount = 0;
+static char *dropped = NULL;
+static int maxDropped = 0;
+static int *work = NULL;
+static int maxWork = 0, workCount = 0;
+
+static int setupLabels(const struct quad_buffer *buf);
+static struct label *label(int n);
+static int threadLabel(const struct quad_buffer *buf, int n);
+static const struct quad *landing(const struct quad_buffer *buf, int i);
+static int fallsInto(const struct quad_buffer *buf, int i, int n);
+static int target(const struct quad *q);
+static void reach(int n);
+static void walkBlock(const struct quad_buffer *buf, int i);
+
+/*
+ * quad_thread_jumps - resolve backpatches and collapse chains of jumps
+ */
+void quad_thread_jumps(struct quad_buffer *buf) {
+    int i, w = 0;
+
+    if (!setupLabels(buf))
+        return;
+
+    for (i = 0; i < buf->nquads; i++) {
+        struct quad *q = &buf->quads[i];
+        int b = q->label - patchBase;
+        if ((q->op == Q_BR || q->op == Q_BT) && q->blank && b >= 0 && b < patchCount && patches[b]) {
+            q->blank = 0;
+            q->label = patches[b];
+        }
+    }
+    for (i = 0; i < buf->nquads; i++) {
+        struct quad *q = &buf->quads[i];
+        if ((q->op == Q_BR || q->op == Q_BT) && !q->blank)
+            q->label = threadLabel(buf, q->label);
+    }
+
+    for (i = 0; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        dropped[i] = q->op == Q_PATCH;
+        if (q->op == Q_BT && !q->blank && i + 1 < buf->nquads && q[1].op == Q_BR &&
+            !q[1].blank && q[1].label == q->label)
+            dropped[i] = 1;
+        else if (q->op == Q_BR && !q->blank && !(i > 0 && q[-1].op == Q_BT && !dropped[i - 1]) &&
+                 fallsInto(buf, i + 1, q->label))
+            dropped[i] = 1;
+        if (!dropped[i] && (q->op == Q_BR || q->op == Q_BT) && !q->blank && label(q->label))
+            label(q->label)->refs++;
+    }
+
+    for (i = 0; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->op == Q_LABEL && label(q->label)->refs == 0)
+            dropped[i] = 1;
+        if (!dropped[i])
+            buf->quads[w++] = *q;
+    }
+    buf->nquads = w;
+}
+
+/*
+ * setupLabels - size the label and backpatch tables to the function's;
+ * returns 0 when it has no labels
+ */
+static int setupLabels(const struct quad_buffer *buf) {
+    int minLabel = 0, maxLabel = 0, minPatch = 0, maxPatch = 0, i;
+
+    for (i = 0; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->op == Q_LABEL) {
+            if (minLabel == 0 || q->label < minLabel)
+                minLabel = q->label;
+            if (q->label > maxLabel)
+                maxLabel = q->label;
+        } else if (q->op == Q_PATCH) {
+            if (minPatch == 0 || q->label < minPatch)
+                minPatch = q->label;
+            if (q->label > maxPatch)
+                maxPatch = q->label;
+        }
+    }
+    if (maxLabel == 0)
+        return 0;
+
+    labelBase = minLabel;
+    labelCount = maxLabel - minLabel + 1;
+    labels = quad_grow(labels, &maxLabels, labelCount, sizeof(struct label));
+    for (i = 0; i < labelCount; i++) {
+        labels[i].at = -1;
+        labels[i].refs = 0;
+        labels[i].thread = 0;
+        labels[i].reached = 0;
+    }
+
+    patchBase = minPatch;
+    patchCount = maxPatch ? maxPatch - minPatch + 1 : 0;
+    patches = quad_grow(patches, &maxPatches, patchCount, sizeof(int));
+    memset(patches, 0, patchCount * sizeof(int));
+
+    dropped = quad_grow(dropped, &maxDropped, buf->nquads, 1);
+    for (i = 0; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->op == Q_LABEL)
+            label(q->label)->at = i;
+        else if (q->op == Q_PATCH)
+            patches[q->label - patchBase] = q->num;
+    }
+    return 1;
+}
+
+static struct label *label(int n) {
+    if (n < labelBase || n - labelBase >= labelCount)
+        return NULL;
+    return &labels[n - labelBase];
+}
+
+/*
+ * threadLabel - the label a branch to n ends up at; a cycle of jumps is
+ * followed no further than once around
+ */
+static int threadLabel(const struct quad_buffer *buf, int n) {
+    int steps = labelCount, next = n;
+    const struct quad *q;
+    struct label *l;
+
+    while (steps-- > 0 && (l = label(next)) != NULL && l->at >= 0) {
+        if (l->thread) {
+            next = l->thread;
+            break;
+        }
+        q = landing(buf, l->at);
+        if (q == NULL || q->op != Q_BR || q->blank || q->label == next)
+            break;
+        next = q->label;
+    }
+    if ((l = label(n)) != NULL)
+        l->thread = next;
+    return next;
+}
+
+/*
+ * landing - the first quad from i on that does something, past labels,
+ * statement marks and backpatches
+ */
+static const struct quad *landing(const struct quad_buffer *buf, int i) {
+    for (; i < buf->nquads; i++) {
+        int op = buf->quads[i].op;
+        if (op != Q_LABEL && op != Q_BGNSTMT && op != Q_PATCH)
+            return &buf->quads[i];
+    }
+    return NULL;
+}
+
+/*
+ * fallsInto - whether running on from i reaches label n without a quad
+ * that does something
+ */
+static int fallsInto(const struct quad_buffer *buf, int i, int n) {
+    for (; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->op == Q_LABEL && q->label == n)
+            return 1;
+        if (q->op != Q_LABEL && q->op != Q_BGNSTMT && q->op != Q_PATCH)
+            return 0;
+    }
+    return 0;
+}
+
+/*
+ * Unreachable code. The blocks of a function start at its labels; a block
+ * goes on to the labels its branches name and, unless it ends in a br or a
+ * ret, into the block after it. The quads of the blocks no path from the
+ * first one reaches are dropped, except for the function's own markers.
+ */
+void quad_drop_unreachable(struct quad_buffer *buf) {
+    int i, w = 0, live = 1;
+
+    if (setupLabels(buf)) {
+        workCount = 0;
+        walkBlock(buf, 0);
+        while (workCount > 0)
+            walkBlock(buf, label(work[--workCount])->at + 1);
+    }
+
+    for (i = 0; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->op == Q_LABEL)
+            live = label(q->label)->reached;
+        if (live || q->op == Q_FEND || q->op == Q_GLOBAL_ALLOC)
+            buf->quads[w++] = *q;
+        if (q->op == Q_BR || q->op == Q_RET)
+            live = 0;
+    }
+    buf->nquads = w;
+}
+
+/*
+ * walkBlock - reach every label the block starting at i branches or
+ * falls to
+ */
+static void walkBlock(const struct quad_buffer *buf, int i) {
+    for (; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->op == Q_LABEL) {
+            reach(q->label);
+            return;
+        }
+        if (q->op == Q_BR || q->op == Q_BT)
+            reach(target(q));
+        if (q->op == Q_BR || q->op == Q_RET)
+            return;
+    }
+}
+
+/*
+ * target - the L label a branch goes to, through its backpatch if it
+ * names a B label; 0 when it was never patched
+ */
+static int target(const struct quad *q) {
+    int b = q->label - patchBase;
+
+    if (!q->blank)
+        return q->label;
+    return b >= 0 && b < patchCount ? patches[b] : 0;
+}
+
+static void reach(int n) {
+    struct label *l = label(n);
+
+    if (l == NULL || l->reached || l->at < 0)
+        return;
+    l->reached = 1;
+    work = quad_grow(work, &maxWork, workCount + 1, sizeof(int));
+    work[workCount++] = n;
+}
+
+/*
+ * Calls evaluated at compile time. A function's finished quads are kept
+ * when it is pure: it returns an int, reads and writes only its int
+ * parameters and its own int locals and arrays, and calls only itself or
+ * functions kept before it. A later call to a kept function whose
+ * arguments are all constants is run on those quads, within a budget of
+ * steps for all of one function's calls and of depth, and becomes the
+ * constant it returns; results, and calls that could not be run on a whole
+ * budget, are remembered by function and arguments.
+ * Whatever the machine might not do the same way, such as dividing by
+ * zero, shifting out of the word, indexing out of an array or reading a
+ * local never written, leaves the call for run time.
+ */
+#define EVALSTEPS 100000        /* quads run for all the calls in one function */
+#define EVALDEPTH 256
+#define EVALARGS 16
+#define EVALCELLS 65536         /* ints of parameters and locals a kept function may have */
+#define PURESLOTS 256
+#define MEMOSLOTS 4096
+#define MEMOARGS 4
+
+enum slot_kind { SLOT_UNSET, SLOT_INT, SLOT_ADDR, SLOT_FUNC };
+
+struct pure {
+    const char *name;           /* in names */
+    struct quad *quads;         /* from its func on; a global ref's num is the pure it names */
+    int nquads;
+    int *args;
+    char *names;
+    int nformals;
+    int ncells;                 /* one per formal, then each local's ints */
+    int *cellAt;                /* by local offset: its first cell */
+    int *cellCount;
+    int tempBase, ntemps;
+    int labelBase, *labelAt;    /* by label: index of its label quad */
+};
+
+struct slot {
+    int kind;                   /* enum slot_kind */
+    int value;                  /* the int, the stack index of a cell, or the pure */
+    int lo, hi;                 /* for an address, the cells of its object */
+};
+
+struct memo {
+    int used;
+    int ok;                     /* 0 when a call site's call was left for run time */
+    int fn, nargs;
+    int args[MEMOARGS];
+    int result;
+};
+
+static struct pure *pures = NULL;
+static int maxPures = 0, pureCount = 0;
+static int *pureSlots = NULL;   /* open addressed by name: pure + 1, or 0 */
+static int pureSlotCount = 0;
+
+static struct slot *stack = NULL;
+static int maxStack = 0, stackTop = 0;
+static long steps = 0;
+
+static struct memo *memos = NULL;
+static int memoCount = 0;
+
+static char *folded = NULL;
+static int maxFolded = 0;
+
+static int findPure(const char *name);
+static void keepPure(const struct quad_buffer *buf);
+static int intConstant(const char *s, int *value);
+static int evalCall(int fn, const int *argv, int nargs, int *result, int depth);
+static int evalBinop(const char *oper, int x, int y, int *result);
+static struct memo *findMemo(int fn, const int *argv, int nargs);
+static unsigned hashName(const char *s);
+static void *copyOf(const void *data, size_t size);
+
+/*
+ * quad_eval_calls - replace the calls to kept functions with constant
+ * arguments by what they return, then keep this function if it is pure.
+ * It depends on every function before this one, so it runs where the
+ * functions are finished in order rather than in quad_optimize.
+ */
+void quad_eval_calls(struct quad_buffer *buf) {
+    int i, j, k, any = 0;
+
+    steps = 0;
+    if (pureCount > 0 && setup(buf)) {
+        folded = quad_grow(folded, &maxFolded, buf->nquads, 1);
+        memset(folded, 0, buf->nquads);
+        for (i = 0; i < buf->nquads; i++) {
+            struct quad *q = &buf->quads[i];
+            int argv[EVALARGS], fn, d, result;
+            char text[16];
+
+            if (q->dst)
+                info(q->dst)->def = i;
+            if (q->op != Q_CALL || q->type != 'i' || q->num > EVALARGS)
+                continue;
+            d = info(q->a)->def;
+            if (d < 0 || buf->quads[d].op != Q_GLOBAL_REF || (fn = findPure(quad_name(buf, &buf->quads[d]))) < 0 ||
+                pures[fn].nformals != q->num)
+                continue;
+            for (k = 0; k < q->num; k++) {
+                d = info(buf->args[q->b + k])->def;
+                if (d < 0 || buf->quads[d].op != Q_CON || !intConstant(quad_name(buf, &buf->quads[d]), &argv[k]))
+                    break;
+            }
+            if (k < q->num)
+                continue;
+
+            /* the call's args go with it, so they must be just before it */
+            for (j = i - 1, k = q->num; k > 0 && j >= 0; j--) {
+                const struct quad *p = &buf->quads[j];
+                if (p->op == Q_ARG && p->a == buf->args[q->b + k - 1])
+                    k--;
+                else if (!pure(p))
+                    break;
+            }
+            if (k > 0)
+                continue;
+            stackTop = 0;
+            if (!evalCall(fn, argv, q->num, &result, 0))
+                continue;
+            for (j = i - 1, k = q->num; k > 0; j--) {
+                if (buf->quads[j].op == Q_ARG) {
+                    folded[j] = 1;
+                    k--;
+                }
+            }
+
+            sprintf(text, "%d", result);
+            q->op = Q_CON;
+            q->type = 0;
+            q->a = q->b = q->num = 0;
+            q->name = buf->nnames;
+            buf->names = quad_grow(buf->names, &buf->maxnames, buf->nnames + strlen(text) + 1, 1);
+            strcpy(buf->names + buf->nnames, text);
+            buf->nnames += strlen(text) + 1;
+            any = 1;
+        }
+    }
+
+    if (any) {
+        for (i = j = 0; i < buf->nquads; i++)
+            if (!folded[i])
+                buf->quads[j++] = buf->quads[i];
+        buf->nquads = j;
+        quad_number_values(buf);    /* the constants may fold on, and the callees' refs go */
+    }
+    keepPure(buf);
+}
+
+/*
+ * findPure - the kept function named name, or -1
+ */
+static int findPure(const char *name) {
+    int i;
+
+    if (pureSlotCount == 0 || name == NULL)
+        return -1;
+    for (i = hashName(name) & (pureSlotCount - 1); pureSlots[i]; i = (i + 1) & (pureSlotCount - 1))
+        if (strcmp(pures[pureSlots[i] - 1].name, name) == 0)
+            return pureSlots[i] - 1;
+    return -1;
+}
+
+/*
+ * keepPure - keep a copy of the function in buf if it is pure
+ */
+static void keepPure(const struct quad_buffer *buf) {
+    int f, i, n, minTemp = 0, maxTemp = 0, minLabel = 0, maxLabel = 0, nlocals = 0, ncells;
+    const char *name;
+    struct pure p;
+
+    for (f = 0; f < buf->nquads && buf->quads[f].op == Q_GLOBAL_ALLOC; f++)
+        ;
+    if (f == buf->nquads || buf->quads[f].op != Q_FUNC || buf->quads[f].num != T_INT)
+        return;
+    name = quad_name(buf, &buf->quads[f]);
+    if (findPure(name) >= 0 || !setup(buf))
+        return;
+
+    memset(&p, 0, sizeof(p));
+    ncells = 0;
+    for (i = f + 1; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        if (q->dst) {
+            if (minTemp == 0 || q->dst < minTemp)
+                minTemp = q->dst;
+            if (q->dst > maxTemp)
+                maxTemp = q->dst;
+            info(q->dst)->def = i;
+        }
+        if (q->op == Q_LABEL) {
+            if (minLabel == 0 || q->label < minLabel)
+                minLabel = q->label;
+            if (q->label > maxLabel)
+                maxLabel = q->label;
+        } else if (q->op == Q_FORMAL) {
+            if (q->num != T_INT || p.nformals == EVALARGS)
+                return;
+            p.nformals++;
+            ncells++;
+        } else if (q->op == Q_LOCALLOC) {
+            if (q->num == T_INT)
+                ncells++;
+            else if (q->num == (T_INT | T_ARRAY) && q->a > 0 && q->a <= EVALCELLS)
+                ncells += q->a;
+            else
+                return;
+            nlocals++;
+        }
+        if (ncells > EVALCELLS)
+            return;
+    }
+
+    /* every quad is one the evaluator runs, and a function is only ever called */
+    for (i = f + 1; i < buf->nquads; i++) {
+        const struct quad *q = &buf->quads[i];
+        int d;
+        switch (q->op) {
+            case Q_BGNSTMT:
+            case Q_FORMAL:
+            case Q_LOCALLOC:
+            case Q_LABEL:
+            case Q_FEND:
+                break;
+            case Q_CON:
+                if (!intConstant(quad_name(buf, q), &d))
+                    return;
+                break;
+            case Q_GLOBAL_REF:
+                if (strcmp(quad_name(buf, q), name) != 0 && findPure(quad_name(buf, q)) < 0)
+                    return;
+                break;
+            case Q_LOCAL_REF:
+                if (q->num < 0 || q->num >= nlocals)
+                    return;
+                break;
+            case Q_PARAM_REF:
+                if (q->num < 0 || q->num >= p.nformals)
+                    return;
+                break;
+            case Q_UNARY:
+                if (q->type != 'i' || (strcmp(q->oper, "@") != 0 && strcmp(q->oper, "-") != 0 &&
+                                       strcmp(q->oper, "~") != 0))
+                    return;
+                break;
+            case Q_BINOP:
+                if (q->type != 'i' || !evalBinop(q->oper, 0, 1, &d))
+                    return;
+                break;
+            case Q_INDEX:
+            case Q_STORE:
+            case Q_ARG:
+                if (q->type != 'i')
+                    return;
+                break;
+            case Q_CALL:
+                d = info(q->a)->def;
+                if (q->type != 'i' || q->num > EVALARGS || d < 0 || buf->quads[d].op != Q_GLOBAL_REF)
+                    return;
+                break;
+            case Q_BR:
+            case Q_BT:
+                if (q->blank || q->label < minLabel || q->label > maxLabel)
+                    return;
+                break;
+            case Q_RET:
+                if (q->a >= 0 && q->type != 'i')
+                    return;
+                break;
+            default:
+                return;
+        }
+        if (q->op != Q_CALL && q->op != Q_ARG && q->op != Q_RET && q->op != Q_BT &&
+            q->op != Q_UNARY && q->op != Q_BINOP && q->op != Q_INDEX && q->op != Q_STORE)
+            continue;
+        if (q->op == Q_BINOP || q->op == Q_INDEX || q->op == Q_STORE) {
+            d = info(q->b)->def;
+            if (d >= 0 && buf->quads[d].op == Q_GLOBAL_REF)
+                return;
+        }
+        if (q->op != Q_CALL && q->a >= 0) {
+            d = info(q->a)->def;
+            if (d >= 0 && buf->quads[d].op == Q_GLOBAL_REF)
+                return;
+        }
+        for (n = 0; q->op == Q_CALL && n < q->num; n++) {
+            d = info(buf->args[q->b + n])->def;
+            if (d >= 0 && buf->quads[d].op == Q_GLOBAL_REF)
+                return;
+        }
+    }
+
+    p.nquads = buf->nquads - f;
+    p.quads = copyOf(buf->quads + f, p.nquads * sizeof(struct quad));
+    p.args = copyOf(buf->args, buf->nargs * sizeof(int));
+    p.names = copyOf(buf->names, buf->nnames);
+    p.name = p.names + buf->quads[f].name;
+    p.ncells = ncells;
+    p.cellAt = copyOf(NULL, (nlocals + 1) * sizeof(int));
+    p.cellCount = copyOf(NULL, (nlocals + 1) * sizeof(int));
+    p.tempBase = minTemp;
+    p.ntemps = maxTemp - minTemp + 1;
+    p.labelBase = minLabel;
+    p.labelAt = copyOf(NULL, (maxLabel - minLabel + 1) * sizeof(int));
+    for (i = 0; i <= maxLabel - minLabel; i++)
+        p.labelAt[i] = -1;
+    for (i = 0, n = p.nformals, nlocals = 0; i < p.nquads; i++) {
+        struct quad *q = &p.quads[i];
+        if (q->op == Q_LOCALLOC) {
+            p.cellAt[nlocals] = n;
+            p.cellCount[nlocals] = q->num == T_INT ? 1 : q->a;
+            n += p.cellCount[nlocals++];
+        } else if (q->op == Q_LABEL)
+            p.labelAt[q->label - minLabel] = i;
+        else if (q->op == Q_GLOBAL_REF)
+            q->num = strcmp(p.names + q->name, p.name) == 0 ? pureCount : findPure(p.names + q->name);
+    }
+
+    pures = quad_grow(pures, &maxPures, pureCount + 1, sizeof(struct pure));
+    pures[pureCount++] = p;
+    if (2 * pureCount > pureSlotCount) {
+        pureSlotCount = pureSlotCount ? 2 * pureSlotCount : PURESLOTS;
+        free(pureSlots);
+        pureSlots = calloc(pureSlotCount, sizeof(int));
+        if (pureSlots == NULL) {
+            fprintf(stderr, "out of memory for quads\n");
+            exit(1);
+        }
+        for (i = 0; i < pureCount - 1; i++) {
+            for (n = hashName(pures[i].name) & (pureSlotCount - 1); pureSlots[n]; n = (n + 1) & (pureSlotCount - 1))
+                ;
+            pureSlots[n] = i + 1;
+        }
+    }
+    for (n = hashName(p.name) & (pureSlotCount - 1); pureSlots[n]; n = (n + 1) & (pureSlotCount - 1))
+        ;
+    pureSlots[n] = pureCount;
+}
+
+/*
+ * evalCall - run kept function fn on nargs ints; returns 0 when the call
+ * must be left for run time
+ */
+static int evalCall(int fn, const int *argv, int nargs, int *result, int depth) {
+    const struct pure *p = &pures[fn];
+    struct memo *m = findMemo(fn, argv, nargs);
+    long start = steps;
+    int frame, temps0, i, pc, ok = 0;
+
+    if (m != NULL && m->used) {
+        *result = m->result;
+        return m->ok;
+    }
+    if (depth > EVALDEPTH || nargs != p->nformals)
+        return 0;
+
+    frame = stackTop;
+    temps0 = frame + p->ncells;
+    stack = quad_grow(stack, &maxStack, temps0 + p->ntemps, sizeof(struct slot));
+    memset(&stack[frame], 0, (p->ncells + p->ntemps) * sizeof(struct slot));
+    stackTop = temps0 + p->ntemps;
+    for (i = 0; i < nargs; i++) {
+        stack[frame + i].kind = SLOT_INT;
+        stack[frame + i].value = argv[i];
+    }
+
+#define TEMP(t) stack[temps0 + (t) - p->tempBase]
+    for (pc = 0; pc < p->nquads; pc++) {
+        const struct quad *q = &p->quads[pc];
+        struct slot x, y, r;
+        int callArgs[EVALARGS], k;
+
+        if (++steps > EVALSTEPS)
+            goto out;
+        memset(&r, 0, sizeof(r));
+        switch (q->op) {
+            case Q_CON:
+                r.kind = SLOT_INT;
+                intConstant(p->names + q->name, &r.value);
+                break;
+            case Q_GLOBAL_REF:
+                r.kind = SLOT_FUNC;
+                r.value = q->num;
+                break;
+            case Q_PARAM_REF:
+                r.kind = SLOT_ADDR;
+                r.value = r.lo = frame + q->num;
+                r.hi = r.lo + 1;
+                break;
+            case Q_LOCAL_REF:
+                r.kind = SLOT_ADDR;
+                r.value = r.lo = frame + p->cellAt[q->num];
+                r.hi = r.lo + p->cellCount[q->num];
+                break;
+            case Q_UNARY:
+                x = TEMP(q->a);
+                if (q->oper[0] == '@') {
+                    if (x.kind != SLOT_ADDR || x.value < x.lo || x.value >= x.hi ||
+                        stack[x.value].kind != SLOT_INT)
+                        goto out;
+                    r = stack[x.value];
+                    break;
+                }
+                if (x.kind != SLOT_INT)
+                    goto out;
+                r.kind = SLOT_INT;
+                r.value = q->oper[0] == '-' ? (int) (0u - (unsigned) x.value) : ~x.value;
+                break;
+            case Q_BINOP:
+                x = TEMP(q->a);
+                y = TEMP(q->b);
+                if (x.kind != SLOT_INT || y.kind != SLOT_INT || !evalBinop(q->oper, x.value, y.value, &r.value))
+                    goto out;
+                r.kind = SLOT_INT;
+                break;
+            case Q_INDEX:
+                x = TEMP(q->a);
+                y = TEMP(q->b);
+                if (x.kind != SLOT_ADDR || y.kind != SLOT_INT || y.value < x.lo - x.value ||
+                    y.value >= x.hi - x.value)
+                    goto out;
+                r = x;
+                r.value += y.value;
+                break;
+            case Q_STORE:
+                x = TEMP(q->a);
+                y = TEMP(q->b);
+                if (x.kind != SLOT_ADDR || x.value < x.lo || x.value >= x.hi || y.kind != SLOT_INT)
+                    goto out;
+                stack[x.value] = y;
+                r = y;
+                break;
+            case Q_CALL:
+                x = TEMP(q->a);
+                if (x.kind != SLOT_FUNC)
+                    goto out;
+                for (k = 0; k < q->num; k++) {
+                    y = TEMP(p->args[q->b + k]);
+                    if (y.kind != SLOT_INT)
+                        goto out;
+                    callArgs[k] = y.value;
+                }
+                if (!evalCall(x.value, callArgs, q->num, &r.value, depth + 1))
+                    goto out;
+                r.kind = SLOT_INT;
+                break;
+            case Q_BT:
+                x = TEMP(q->a);
+                if (x.kind != SLOT_INT)
+                    goto out;
+                if (x.value && (pc = p->labelAt[q->label - p->labelBase]) < 0)
+                    goto out;
+                continue;
+            case Q_BR:
+                if ((pc = p->labelAt[q->label - p->labelBase]) < 0)
+                    goto out;
+                continue;
+            case Q_RET:
+                *result = 0;
+                if (q->a >= 0) {
+                    x = TEMP(q->a);
+                    if (x.kind != SLOT_INT)
+                        goto out;
+                    *result = x.value;
+                }
+                ok = 1;
+                goto out;
+            case Q_FEND:
+                *result = 0;    /* falling off the end returns 0, as the code generator has it */
+                ok = 1;
+                goto out;
+            default:
+                continue;
+        }
+        TEMP(q->dst) = r;
+    }
+#undef TEMP
+
+out:
+    stackTop = frame;
+    /* a call left only for want of what the function's earlier calls used may run elsewhere */
+    if ((ok || (depth == 0 && (start == 0 || steps <= EVALSTEPS))) && (m = findMemo(fn, argv, nargs)) != NULL) {
+        if (!m->used)
+            memoCount++;
+        m->used = 1;
+        m->ok = ok;
+        m->fn = fn;
+        m->nargs = nargs;
+        memcpy(m->args, argv, nargs * sizeof(int));
+        m->result = ok ? *result : 0;
+    }
+    return ok;
+}
+
+/*
+ * evalBinop - x oper y as the machine computes it; 0 when it would trap
+ * or is undefined
+ */
+static int evalBinop(const char *oper, int x, int y, int *result) {
+    switch (oper[0]) {
+        case '+':
+            *result = (int) ((unsigned) x + (unsigned) y);
+            return 1;
+        case '-':
+            *result = (int) ((unsigned) x - (unsigned) y);
+            return 1;
+        case '*':
+            *result = (int) ((unsigned) x * (unsigned) y);
+            return 1;
+        case '/':
+        case '%':
+            if (y == 0 || (x == INT_MIN && y == -1))
+                return 0;
+            *result = oper[0] == '/' ? x / y : x % y;
+            return 1;
+        case '&':
+            *result = x & y;
+            return 1;
+        case '|':
+            *result = x | y;
+            return 1;
+        case '^':
+            *result = x ^ y;
+            return 1;
+        case '=':
+            *result = x == y;
+            return oper[1] == '=';
+        case '!':
+            *result = x != y;
+            return oper[1] == '=';
+        case '<':
+            if (oper[1] != '<') {
+                *result = oper[1] == '=' ? x <= y : x < y;
+                return 1;
+            }
+            if (y < 0 || y > 31)
+                return 0;
+            *result = (int) ((unsigned) x << y);
+            return 1;
+        case '>':
+            if (oper[1] != '>') {
+                *result = oper[1] == '=' ? x >= y : x > y;
+                return 1;
+            }
+            if (y < 0 || y > 31)
+                return 0;
+            *result = x >> y;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * findMemo - the remembered result of fn on these arguments, the empty
+ * slot for it, or NULL when it cannot be remembered
+ */
+static struct memo *findMemo(int fn, const int *argv, int nargs) {
+    unsigned h = (unsigned) fn * 2654435761U;
+    int i, slot;
+
+    if (nargs > MEMOARGS)
+        return NULL;
+    if (memos == NULL) {
+        memos = calloc(MEMOSLOTS, sizeof(struct memo));
+        if (memos == NULL) {
+            fprintf(stderr, "out of memory for quads\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < nargs; i++)
+        h = (h ^ (unsigned) argv[i]) * 16777619u;
+    for (i = 0, slot = h & (MEMOSLOTS - 1); i < MEMOSLOTS / 2; i++, slot = (slot + 1) & (MEMOSLOTS - 1)) {
+        struct memo *m = &memos[slot];
+        if (!m->used)
+            return memoCount < MEMOSLOTS / 2 ? m : NULL;
+        if (m->fn == fn && m->nargs == nargs && memcmp(m->args, argv, nargs * sizeof(int)) == 0)
+            return m;
+    }
+    return NULL;
+}
+
+/*
+ * intConstant - the value of constant text s if it is an int
+ */
+static int intConstant(const char *s, int *value) {
+    long v;
+    char *end;
+
+    if (s == NULL || strpbrk(s, ".eE") != NULL)
+        return 0;
+    v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v < INT_MIN || v > INT_MAX)
+        return 0;
+    *value = (int) v;
+    return 1;
+}
+
+static unsigned hashName(const char *s) {
+    unsigned h = 2166136261u;
+
+    while (*s)
+        h = (h ^ (unsigned char) *s++) * 16777619u;
+    return h;
+}
+
+/*
+ * copyOf - a lasting copy of size bytes at data, zeroed when data is NULL
+ */
+static void *copyOf(const void *data, size_t size) {
+    void *p = calloc(1, size ? size : 1);
+
+    if (p == NULL) {
+        fprintf(stderr, "out of memory for quads\n");
+        exit(1);
+    }
+    if (data != NULL)
+        memcpy(p, data, size);
+    return p;
+}
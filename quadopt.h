@@ -0,0 +1,30 @@
+#ifndef QUADOPT_H
+#define QUADOPT_H
+
+#include "quadbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Passes over the quads of one function, run by quad_flush before they are
+ * printed or handed on. A pass rewrites the buffer in place, and leaves
+ * every temp that is read defined by an earlier quad.
+ */
+void quad_optimize(struct quad_buffer *buf);
+void quad_number_values(struct quad_buffer *buf);
+void quad_thread_jumps(struct quad_buffer *buf);
+void quad_drop_unreachable(struct quad_buffer *buf);
+
+/*
+ * Run where the functions are finished in order, after quad_optimize, since
+ * it uses what was learnt from the functions before.
+ */
+void quad_eval_calls(struct quad_buffer *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
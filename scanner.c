@@ -0,0 +1,383 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include "cc.h"
+# include "semutil.h"
+# include "sym.h"
+# include "scan.h"
+# include "scanner.h"
+# include "y.tab.h"
+
+#define KEYSLOTS 64
+#define READCHUNK 65536
+
+extern int lineno;
+
+char *slookupn(char *s, int len);
+
+/*
+ * Scanner over the whole source at once. Standard input is mapped when it is
+ * a regular file and read into one buffer otherwise; tokens are scanned in
+ * place between cur and end, and the text of an ID, CON or STR is handed on
+ * as its interned copy, so no token allocates. Constants keep their text and
+ * are only converted by the actions that need the value.
+ */
+enum char_class {
+    C_OTHER,        /* returned as itself */
+    C_SPACE,
+    C_NEWLINE,
+    C_ALPHA,        /* letters and '_' */
+    C_DIGIT,
+    C_QUOTE,
+    C_OP            /* first character of an entry in ops */
+};
+
+static char *src = NULL;
+static char *cur = NULL;
+static char *end = NULL;
+
+static const struct scan_body *skips = NULL;     /* bodies scan_skip passes over */
+static int nskips = 0;
+static int skipFirst = 0, skipLast = 0;
+static int skipNext = 0;
+static char *skipAt = NULL;                     /* start of body skipNext */
+
+static unsigned char charClass[256];
+static signed char opFirst[256];
+
+/*
+ * keywords - perfect hash of the reserved words; keyHash puts every word in
+ * its own slot, so a name is a keyword only if it matches that one slot
+ */
+static const struct {
+    const char *name;
+    int len;
+    int token;
+} keywords[KEYSLOTS] = {
+    [0] = { "return", 6, RETURN },
+    [2] = { "unsigned", 8, RESERVED },
+    [6] = { "if", 2, IF },
+    [7] = { "const", 5, RESERVED },
+    [10] = { "extern", 6, RESERVED },
+    [11] = { "continue", 8, CONTINUE },
+    [12] = { "break", 5, BREAK },
+    [13] = { "auto", 4, RESERVED },
+    [15] = { "double", 6, DOUBLE },
+    [17] = { "int", 3, INT },
+    [19] = { "else", 4, ELSE },
+    [20] = { "while", 5, WHILE },
+    [21] = { "volatile", 8, RESERVED },
+    [23] = { "static", 6, RESERVED },
+    [28] = { "signed", 6, RESERVED },
+    [29] = { "for", 3, FOR },
+    [30] = { "register", 8, RESERVED },
+    [31] = { "default", 7, RESERVED },
+    [33] = { "goto", 4, GOTO },
+    [37] = { "union", 5, RESERVED },
+    [38] = { "sizeof", 6, RESERVED },
+    [39] = { "short", 5, RESERVED },
+    [44] = { "struct", 6, RESERVED },
+    [45] = { "do", 2, DO },
+    [48] = { "switch", 6, RESERVED },
+    [49] = { "float", 5, RESERVED },
+    [55] = { "case", 4, RESERVED },
+    [56] = { "char", 4, RESERVED },
+    [57] = { "typedef", 7, RESERVED },
+    [59] = { "enum", 4, RESERVED },
+    [60] = { "void", 4, RESERVED },
+    [63] = { "long", 4, RESERVED },
+};
+
+/*
+ * ops - operators, grouped by first character with the longest first
+ */
+static const struct {
+    const char *text;
+    int len;
+    int token;
+} ops[] = {
+    { "<<=", 3, SETLSH }, { "<<", 2, LSH }, { "<=", 2, LE }, { "<", 1, LT },
+    { ">>=", 3, SETRSH }, { ">>", 2, RSH }, { ">=", 2, GE }, { ">", 1, GT },
+    { "|=", 2, SETOR }, { "||", 2, OR }, { "|", 1, BITOR },
+    { "^=", 2, SETXOR }, { "^", 1, BITXOR },
+    { "&=", 2, SETAND }, { "&&", 2, AND }, { "&", 1, BITAND },
+    { "+=", 2, SETADD }, { "+", 1, ADD },
+    { "-=", 2, SETSUB }, { "-", 1, SUB },
+    { "*=", 2, SETMUL }, { "*", 1, MUL },
+    { "/=", 2, SETDIV }, { "/", 1, DIV },
+    { "%=", 2, SETMOD }, { "%", 1, MOD },
+    { "==", 2, EQ }, { "=", 1, SET },
+    { "!=", 2, NE }, { "!", 1, NOT },
+    { "~", 1, COM },
+    { NULL, 0, 0 }
+};
+
+static void readSource();
+static int keyHash(const char *s, int len);
+static int skipComment();
+static void nextSkip();
+
+/*
+ * initlex - map the source and set up the character tables
+ */
+void initlex() {
+    int c, i;
+
+    for (c = 0; c < 256; c++) {
+        charClass[c] = C_OTHER;
+        opFirst[c] = -1;
+    }
+    for (c = 'a'; c <= 'z'; c++)
+        charClass[c] = charClass[c - 'a' + 'A'] = C_ALPHA;
+    charClass['_'] = C_ALPHA;
+    for (c = '0'; c <= '9'; c++)
+        charClass[c] = C_DIGIT;
+    charClass[' '] = charClass['\t'] = charClass['\r'] = charClass['\f'] = charClass['\v'] = C_SPACE;
+    charClass['\n'] = C_NEWLINE;
+    charClass['"'] = C_QUOTE;
+    for (i = 0; ops[i].text; i++) {
+        c = (unsigned char) ops[i].text[0];
+        charClass[c] = C_OP;
+        if (opFirst[c] < 0)
+            opFirst[c] = i;
+    }
+
+    readSource();
+}
+
+/*
+ * yylex - the next token, 0 at the end of the source
+ */
+int yylex() {
+    char *start;
+    int c, i;
+
+    if (cur == skipAt) {
+        lineno += skips[skipNext].lines;
+        cur = src + skips[skipNext].end;
+        skipNext++;
+        nextSkip();
+    }
+    for (;;) {
+        if (cur == end)
+            return 0;
+        c = (unsigned char) *cur;
+        if (charClass[c] == C_SPACE)
+            cur++;
+        else if (charClass[c] == C_NEWLINE) {
+            lineno++;
+            cur++;
+        } else if (c != '/' || !skipComment())
+            break;
+    }
+
+    start = cur;
+    switch (charClass[c]) {
+    case C_ALPHA:
+        while (++cur < end && (charClass[(unsigned char) *cur] == C_ALPHA || charClass[(unsigned char) *cur] == C_DIGIT))
+            ;
+        if ((i = keyHash(start, cur - start)) >= 0)
+            return keywords[i].token;
+        yylval.str_ptr = slookupn(start, cur - start);
+        return ID;
+
+    case C_DIGIT:
+        while (cur < end && (charClass[(unsigned char) *cur] == C_DIGIT || *cur == '.'))
+            cur++;
+        if (cur < end && (*cur == 'e' || *cur == 'E')) {
+            char *exp = cur + 1;
+            if (exp < end && (*exp == '+' || *exp == '-'))
+                exp++;
+            if (exp < end && charClass[(unsigned char) *exp] == C_DIGIT) {
+                for (cur = exp; cur < end && charClass[(unsigned char) *cur] == C_DIGIT; cur++)
+                    ;
+            }
+        }
+        yylval.str_ptr = slookupn(start, cur - start);
+        return CON;
+
+    case C_QUOTE:
+        for (cur++; cur < end && *cur != '"'; cur++) {
+            if (*cur == '\n')
+                lineno++;
+            else if (*cur == '\\' && cur + 1 < end)
+                cur++;
+        }
+        yylval.str_ptr = slookupn(start + 1, cur - start - 1);
+        if (cur < end)
+            cur++;
+        return STR;
+
+    case C_OP:
+        for (i = opFirst[c]; ops[i].text && ops[i].text[0] == c; i++) {
+            if (end - cur >= ops[i].len && memcmp(cur, ops[i].text, ops[i].len) == 0) {
+                cur += ops[i].len;
+                return ops[i].token;
+            }
+        }
+        break;
+    }
+
+    cur++;
+    return c;
+}
+
+/*
+ * scan_bodies - find the top-level function bodies of the whole source
+ * without parsing it: only braces count, outside comments and strings.
+ * Returns how many there are, in order, in a table that is never freed.
+ */
+int scan_bodies(struct scan_body **bodies) {
+    struct scan_body *list = NULL;
+    int n = 0, max = 0, depth = 0, line = 0, startLine = 0;
+    char *p;
+
+    for (p = src; p < end; p++) {
+        switch (*p) {
+        case '\n':
+            line++;
+            break;
+        case '"':
+            for (p++; p < end && *p != '"'; p++) {
+                if (*p == '\n')
+                    line++;
+                else if (*p == '\\' && p + 1 < end)
+                    p++;
+            }
+            break;
+        case '/':
+            if (p + 1 < end && p[1] == '/') {
+                while (p + 1 < end && p[1] != '\n')
+                    p++;
+            } else if (p + 1 < end && p[1] == '*') {
+                for (p += 2; p < end && !(*p == '*' && p + 1 < end && p[1] == '/'); p++)
+                    if (*p == '\n')
+                        line++;
+                if (p < end)
+                    p++;
+            }
+            break;
+        case '{':
+            if (depth++ > 0)
+                break;
+            if (n == max) {
+                max = max ? max * 2 : 256;
+                if ((list = realloc(list, max * sizeof(*list))) == NULL) {
+                    fprintf(stderr, "out of memory\n");
+                    exit(1);
+                }
+            }
+            list[n].start = p + 1 - src;
+            startLine = line;
+            break;
+        case '}':
+            if (depth > 0 && --depth == 0) {
+                list[n].end = p - src;
+                list[n++].lines = line - startLine;
+            }
+            break;
+        }
+    }
+    *bodies = list;
+    return n;
+}
+
+/*
+ * scan_skip - pass over the bodies outside [first, last) as if they were
+ * empty, counting their lines
+ */
+void scan_skip(const struct scan_body *bodies, int n, int first, int last) {
+    skips = bodies;
+    nskips = n;
+    skipFirst = first;
+    skipLast = last;
+    skipNext = 0;
+    nextSkip();
+}
+
+/*
+ * nextSkip - move skipNext to the next body scan_skip passes over
+ */
+static void nextSkip() {
+    if (skipNext >= skipFirst && skipNext < skipLast)
+        skipNext = skipLast;
+    skipAt = skipNext < nskips ? src + skips[skipNext].start : NULL;
+}
+
+/*
+ * readSource - map standard input, or read all of it when it cannot be mapped
+ */
+static void readSource() {
+    struct stat info;
+    size_t size = 0, max = 0;
+    ssize_t got;
+
+    if (fstat(0, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, 0, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t) info.st_size, MADV_SEQUENTIAL);
+            src = map;
+            cur = src;
+            end = src + info.st_size;
+            return;
+        }
+    }
+
+    for (;;) {
+        if (size == max) {
+            max = max ? max * 2 : READCHUNK;
+            if ((src = realloc(src, max)) == NULL) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+        }
+        if ((got = read(0, src + size, max - size)) <= 0)
+            break;
+        size += got;
+    }
+    cur = src;
+    end = src + size;
+}
+
+/*
+ * keyHash - the keywords slot of the len characters at s, or -1 when they
+ * are not a keyword
+ */
+static int keyHash(const char *s, int len) {
+    int h;
+
+    if (len < 2 || len > 8)
+        return -1;
+    h = ((unsigned char) s[0] * 14 + (unsigned char) s[len - 1] * 5 + len * 5) & (KEYSLOTS - 1);
+    if (keywords[h].len == len && memcmp(keywords[h].name, s, len) == 0)
+        return h;
+    return -1;
+}
+
+/*
+ * skipComment - step over the comment at cur, counting its lines; 0 when
+ * cur is not at a comment
+ */
+static int skipComment() {
+    if (end - cur < 2)
+        return 0;
+    if (cur[1] == '/') {
+        while (cur < end && *cur != '\n')
+            cur++;
+        return 1;
+    }
+    if (cur[1] != '*')
+        return 0;
+    for (cur += 2; cur < end; cur++) {
+        if (*cur == '\n')
+            lineno++;
+        else if (*cur == '*' && cur + 1 < end && cur[1] == '/') {
+            cur += 2;
+            return 1;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,17 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+/*
+ * scan_body - the inside of one top-level function body, between its
+ * braces, as offsets into the source
+ */
+struct scan_body {
+    long start;                 /* just past the '{' */
+    long end;                   /* at the closing '}' */
+    int lines;                  /* newlines in between */
+};
+
+int scan_bodies(struct scan_body **bodies);
+void scan_skip(const struct scan_body *bodies, int n, int first, int last);
+
+#endif
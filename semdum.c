@@ -3,15 +3,21 @@
 # include "sem.h"
 # include "sym.h"
 # include "cc.h"
+# include "quadbuf.h"
 # include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <math.h>
 
 #define MAXARGS 50
 #define MAXLOCS 50
 #define MAXLINES 80
-#define MAXRECS 4096
-#define MAXLABELS 50
-#define MAXBLANKS 256
+#define LABELBUCKETS 64
+#define HINTSLOTS 256
+#define CONSTSLOTS 256
+#define ARENACHUNK 1024
+#define BACK_LIST 0
+#define FALSE_LIST 1
 #define OPB 0
 #define OP1 1
 #define OP2 2
@@ -26,25 +32,99 @@ extern char formalnames[MAXARGS][MAXLINES];   /* names of formal arguments  */
 extern int ntmp;
 
 int currentFunctionType;
+int inFunction = 0;
 int labelNum = 0;
 int blankLabel = 0;
+int numberEachFunction = 0;     /* set in a forked front end of parseJobs */
 int labelScope = 1;
 
+/*
+ * Goto labels used before their declaration, hashed by name. An entry only
+ * counts while its generation is the current function's, so ending a
+ * function just bumps labelGeneration; stale entries are reused in place.
+ */
 struct BackpatchLabel {
-    char labelName[256];
-    int labels[MAXBLANKS];
+    char *labelName;
+    int *labels;
     int topLabel;
+    int maxLabels;
     int patched;
+    int generation;
+    struct BackpatchLabel *next;
 } typedef BackpatchLabel;
 
-BackpatchLabel bpArr[MAXLABELS];
+BackpatchLabel **bpHash = NULL;
+int bpBuckets = 0;
+int bpEntries = 0;
+int labelGeneration = 1;
+
+BackpatchLabel **bpArr = NULL;      /* this function's entries, in order of first goto */
 int currBpArr = 0;
+int maxBpArr = 0;
+
+int *argTemps = NULL;
+int maxArgTemps = 0;
+
+/*
+ * Tail hints for the backpatch and argument lists. A sem_rec has no tail
+ * pointer, so the last node seen for a list head is kept here, keyed by the
+ * head and the link the list runs through (back or s_false). A hint is only
+ * where the walk to the end starts, so lists appended to elsewhere (merge in
+ * semutil.c) stay correct. Like the labels, hints expire by generation.
+ */
+struct TailHint {
+    struct sem_rec *head;
+    struct sem_rec *tail;
+    int link;
+    int generation;
+} typedef TailHint;
+
+TailHint *tailHints = NULL;
+int hintSlots = 0;
+int hintCount = 0;
+int hintGeneration = 1;
 
+/*
+ * Constant temps. con() and the folded actions hand out a temp without
+ * emitting its quad; the value is kept here, keyed by the temp, and the quad
+ * is only emitted once the temp is used as a run-time operand (useTemp). Only
+ * values con() can print are kept: ints, and doubles that are whole ints,
+ * which become a con and a cvf. Like the tail hints, entries expire by
+ * generation at the end of each function.
+ */
+struct ConstTemp {
+    int place;
+    int mode;
+    int ival;
+    double fval;
+    int emitted;
+    int generation;
+} typedef ConstTemp;
+
+ConstTemp *constTemps = NULL;
+int constSlots = 0;
+int constCount = 0;
+int constGeneration = 1;
+
+/*
+ * Arena for this file's sem_recs. Nodes are handed out in order from a chain
+ * of chunks, and none is freed on its own: no node outlives its function, so
+ * ftail rewinds to the first chunk and the chunks are reused by the next one.
+ */
+struct ArenaChunk {
+    struct sem_rec nodes[ARENACHUNK];
+    struct ArenaChunk *next;
+} typedef ArenaChunk;
+
+ArenaChunk *arenaHead = NULL;
+ArenaChunk *arenaChunk = NULL;      /* chunk being handed out, NULL before the first node */
+int arenaUsed = 0;
 
 /* Stack and Stack Helpers */
 struct Stack {
-    struct sem_rec *data[MAXRECS];
+    struct sem_rec **data;
     int size;
+    int max;
 } typedef Stack;
 
 Stack continueStack;
@@ -62,26 +142,40 @@ void dfsBackpatch(struct sem_rec *rec, int true, int trueM, int falseM);
 
 struct sem_rec *mergeFalse(struct sem_rec *p1, struct sem_rec *p2);
 
+struct sem_rec *mergeList(struct sem_rec *p1, struct sem_rec *p2);
+
+struct sem_rec *appendList(struct sem_rec *p1, struct sem_rec *p2, int link);
+
 int selectOp(char *op);
 
 BackpatchLabel *findLabel(char *id);
 
 void addLabel(int labelNo, char *id);
 
-void setBackpatchedLabel(char *id);
-
 void checkUnpatchedLabels();
 
 void clearLabelArray();
 
 void backpatchGotoLabels(BackpatchLabel *list, int label);
 
+struct sem_rec *newNode(int place, int mode, struct sem_rec *p1, struct sem_rec *p2);
+
+ConstTemp *findConst(struct sem_rec *x);
+
+struct sem_rec *constant(int mode, int ival, double fval);
+
+void useTemp(struct sem_rec *x);
+
+struct sem_rec *foldBinary(char *op, struct sem_rec *x, struct sem_rec *y);
+
+int foldRelation(char *op, struct sem_rec *x, struct sem_rec *y);
+
 /*
  * backpatch - backpatch list of quadruples starting at p with k
  */
 void backpatch(struct sem_rec *p, int k) {
     if (p)
-        printf("B%d=L%d\n", p->s_place, k);
+        quad_patch(p->s_place, k);
 }
 
 /*
@@ -89,14 +183,14 @@ void backpatch(struct sem_rec *p, int k) {
  */
 void bgnstmt() {
     extern int lineno;
-    printf("bgnstmt %d\n", lineno);
+    quad_bgnstmt(lineno);
 }
 
 /*
  * call - procedure invocation
  * Check if it's been installed, otherwise, install it as T_INT function.
- * Go through args linked list (from cexprs) and print out each one as an argument.
- * Then print out instruction: number of args, temp args, and function name.
+ * Go through args linked list (from cexprs) and emit each one as an argument.
+ * Then emit the call: number of args, temp args, and function name.
  */
 struct sem_rec *call(char *f, struct sem_rec *args) {
     struct id_entry *idEntry;
@@ -108,32 +202,24 @@ struct sem_rec *call(char *f, struct sem_rec *args) {
     }
 
     int numArgs = 0;
-    char argTemps[256];
-    char *target = argTemps;
     while (args) {
         char type = args->s_mode == T_DOUBLE ? 'f' : 'i';
-        printf("arg%c t%d\n", type, args->s_place);
-        if (args->back.s_link)
-            target += sprintf(target, "t%d ", args->s_place);
-        else
-            target += sprintf(target, "t%d", args->s_place);
+        useTemp(args);
+        quad_arg(type, args->s_place);
+        argTemps = quad_grow(argTemps, &maxArgTemps, numArgs + 1, sizeof(int));
+        argTemps[numArgs++] = args->s_place;
         args = args->back.s_link;
-        numArgs++;
     }
 
     int funcTemp = nexttemp();
-    printf("t%d := global %s\n", funcTemp, idEntry->i_name);
+    quad_ref(funcTemp, GLOBAL, idEntry->i_name, 0);
 
     int temp = nexttemp();
     char funcType = idEntry->i_type == T_INT ? 'i' : 'f';
-
-    if (numArgs > 0)
-        printf("t%d := f%c t%d %d %s\n", temp, funcType, funcTemp, numArgs, argTemps);
-    else
-        printf("t%d := f%c t%d %d\n", temp, funcType, funcTemp, numArgs);
+    quad_call(temp, funcType, funcTemp, numArgs, argTemps);
 
     labelScope = 1;
-    return node(temp, idEntry->i_type, NULL, NULL);
+    return newNode(temp, idEntry->i_type, NULL, NULL);
 }
 
 /*
@@ -143,7 +229,7 @@ struct sem_rec *call(char *f, struct sem_rec *args) {
 struct sem_rec *ccand(struct sem_rec *e1, int m, struct sem_rec *e2) {
     labelScope = 1;
     dfsBackpatch(e1->back.s_true, 1, m, -1);
-    struct sem_rec *ret = node(
+    struct sem_rec *ret = newNode(
             0,
             0,
             e2->back.s_true,
@@ -167,7 +253,7 @@ struct sem_rec *ccexpr(struct sem_rec *e) {
  */
 struct sem_rec *ccnot(struct sem_rec *e) {
     labelScope = 1;
-    return node(0, 0, e->s_false, e->back.s_true);
+    return newNode(0, 0, e->s_false, e->back.s_true);
 }
 
 /*
@@ -177,10 +263,10 @@ struct sem_rec *ccnot(struct sem_rec *e) {
 struct sem_rec *ccor(struct sem_rec *e1, int m, struct sem_rec *e2) {
     labelScope = 1;
     dfsBackpatch(e1->s_false, 0, -1, m);
-    struct sem_rec *ret = node(
+    struct sem_rec *ret = newNode(
             0,
             0,
-            merge(e1->back.s_true, e2->back.s_true),
+            mergeList(e1->back.s_true, e2->back.s_true),
             e2->s_false
     );
     return ret;
@@ -188,6 +274,8 @@ struct sem_rec *ccor(struct sem_rec *e1, int m, struct sem_rec *e2) {
 
 /*
  * con - constant reference in an expression
+ * An int literal is only recorded; its quad waits until something needs the
+ * value at run time, so expressions of literals fold away entirely.
  */
 struct sem_rec *con(char *x) {
     struct id_entry *idEntry;
@@ -198,10 +286,16 @@ struct sem_rec *con(char *x) {
         idEntry->i_defined = 1;
     }
 
+    char *end;
+    long value = strtol(x, &end, 10);
+    labelScope = 1;
+    if (idEntry->i_type == T_INT && end != x && *end == '\0' && value >= INT_MIN && value <= INT_MAX)
+        return constant(T_INT, (int) value, 0);
+
     int temp = nexttemp();
-    printf("t%d := %s\n", temp, x);
+    quad_con(temp, x);
     labelScope = 1;
-    return node(temp, idEntry->i_type, NULL, NULL);
+    return newNode(temp, idEntry->i_type, NULL, NULL);
 }
 
 /*
@@ -211,7 +305,7 @@ struct sem_rec *con(char *x) {
  */
 void dobreak() {
     if (breakStack.size > 0)
-        merge(stackTop(&breakStack), n());
+        mergeList(stackTop(&breakStack), n());
     else
         yyerror(" break statement not inside of a loop");
 }
@@ -222,7 +316,7 @@ void dobreak() {
  */
 void docontinue() {
     if (continueStack.size > 0)
-        merge(stackTop(&continueStack), n());
+        mergeList(stackTop(&continueStack), n());
     else
         yyerror(" continue statement not inside of a loop");
 }
@@ -238,10 +332,8 @@ void dodo(int m1, int m2, struct sem_rec *e, int m3) {
 
     // if continue is used, backpatch with start of while-loop
     dfsBackpatch(stackTop(&continueStack)->back.s_link, 1, m2, -1);
-    // if break is used, backpatch with exit of loop
-    dfsBackpatch(stackTop(&breakStack)->back.s_link, 1, m3, -1);
 
-    endloopscope(-1);
+    endloopscope(m3);
 }
 
 /*
@@ -260,10 +352,7 @@ void dofor(int m1, struct sem_rec *e2, int m2, struct sem_rec *n1,
     backpatch(n1, m1); // B7
     backpatch(n2, m2); // B14
 
-    // if break is used, backpatch with exit of loop
-    dfsBackpatch(stackTop(&breakStack)->back.s_link, 1, m4, -1); // B10
-
-    endloopscope(-1);
+    endloopscope(m4); // B10
 }
 
 
@@ -283,32 +372,89 @@ void doif(struct sem_rec *e, int m1, int m2) {
  * back union instead of the false list, which created problems with my navigation of LL.
  */
 struct sem_rec *mergeFalse(struct sem_rec *p1, struct sem_rec *p2) {
-    struct sem_rec *p;
+    return appendList(p1, p2, FALSE_LIST);
+}
+
+/*
+ * Same as merge in semutil.c (append through the back union), but starting
+ * from the tail hint so a long list is not walked on every append.
+ */
+struct sem_rec *mergeList(struct sem_rec *p1, struct sem_rec *p2) {
+    return appendList(p1, p2, BACK_LIST);
+}
+
+/*
+ * Tail Hint Helpers
+ * nextLink: the link field a list runs through
+ * findHint: the hint slot for a head, or the empty slot to put it in
+ * listTail: last node of a list, found from its hint and remembered
+ * appendList: attach p2 to the end of p1 in O(1) when p1's tail is known
+ */
+struct sem_rec **nextLink(struct sem_rec *p, int link) {
+    return link == FALSE_LIST ? &p->s_false : &p->back.s_link;
+}
 
+TailHint *findHint(struct sem_rec *head, int link) {
+    if (hintCount * 2 >= hintSlots) {
+        TailHint *oldHints = tailHints;
+        int oldSlots = hintSlots, i;
+
+        hintSlots = hintSlots ? 2 * hintSlots : HINTSLOTS;
+        tailHints = calloc(hintSlots, sizeof(TailHint));
+        hintCount = 0;
+        for (i = 0; i < oldSlots; i++) {
+            if (oldHints[i].generation == hintGeneration) {
+                *findHint(oldHints[i].head, oldHints[i].link) = oldHints[i];
+                hintCount++;
+            }
+        }
+        free(oldHints);
+    }
+
+    unsigned long h = ((unsigned long) head >> 4) * 2654435761UL + link;
+    int slot = (int) (h & (unsigned long) (hintSlots - 1));
+    while (tailHints[slot].generation == hintGeneration &&
+           (tailHints[slot].head != head || tailHints[slot].link != link))
+        slot = (slot + 1) & (hintSlots - 1);
+    return &tailHints[slot];
+}
+
+struct sem_rec *listTail(struct sem_rec *head, int link) {
+    TailHint *hint = findHint(head, link);
+    struct sem_rec *p = hint->generation == hintGeneration ? hint->tail : head;
+
+    while (*nextLink(p, link))
+        p = *nextLink(p, link);
+
+    if (hint->generation != hintGeneration)
+        hintCount++;
+    hint->head = head;
+    hint->tail = p;
+    hint->link = link;
+    hint->generation = hintGeneration;
+    return p;
+}
+
+struct sem_rec *appendList(struct sem_rec *p1, struct sem_rec *p2, int link) {
     if (p1 == NULL)
         return (p2);
     if (p2 == NULL)
         return (p1);
-    for (p = p1; p->s_false; p = p->s_false);
-    p->s_false = p2;
+
+    struct sem_rec *tail = listTail(p2, link);
+    *nextLink(listTail(p1, link), link) = p2;
+    findHint(p1, link)->tail = tail;
     return (p1);
 }
 
 /*
  * Go through a sem_rec linked list and backpatch all the links
- * depending on which branch.
+ * depending on which branch. Walks the list in a loop rather than
+ * recursing per node, so long lists cannot overflow the C stack.
  */
 void dfsBackpatch(struct sem_rec *rec, int true, int trueM, int falseM) {
-    if (rec == NULL) return;
-
-    if (true) {
-        backpatch(rec, trueM);
-        dfsBackpatch(rec->back.s_true, 1, trueM, falseM);
-
-    } else {
-        backpatch(rec, falseM);
-        dfsBackpatch(rec->s_false, 0, trueM, falseM);
-    }
+    for (; rec != NULL; rec = true ? rec->back.s_true : rec->s_false)
+        backpatch(rec, true ? trueM : falseM);
 }
 
 /*
@@ -336,10 +482,11 @@ void doret(struct sem_rec *e) {
         }
 
         char type = e->s_mode == T_INT ? 'i' : 'f';
-        printf("ret%c t%d\n", type, e->s_place);
+        useTemp(e);
+        quad_ret(type, e->s_place);
     } else {
         char type = currentFunctionType == T_INT ? 'i' : 'f';
-        printf("ret%c\n", type);
+        quad_ret(type, -1);
     }
 
 }
@@ -357,16 +504,16 @@ void dowhile(int m1, struct sem_rec *e, int m2, struct sem_rec *n,
 
     // if continue is used, backpatch with start of while-loop
     dfsBackpatch(stackTop(&continueStack)->back.s_link, 1, m1, -1);
-    // if break is used, backpatch with exit of loop
-    dfsBackpatch(stackTop(&breakStack)->back.s_link, 1, m3, -1);
 
-    endloopscope(-1);
+    endloopscope(m3);
 }
 
 /*
  * endloopscope - end the scope for a loop
+ * If break is used, backpatch with m, the exit of the loop.
  */
 void endloopscope(int m) {
+    dfsBackpatch(stackTop(&breakStack)->back.s_link, 1, m, -1);
     stackPop(&continueStack);
     stackPop(&breakStack);
     leaveblock();
@@ -375,17 +522,13 @@ void endloopscope(int m) {
 /*
  * exprs - form a list of expressions
  * Return l (list) after adding sem_rec e to the back of the list
- * each time. Traverse the list of pointers until the end.
+ * each time, through mergeList's tail hint.
  * The list s_link will act as the list.
  * Uses: argument list in calls
  */
 struct sem_rec *exprs(struct sem_rec *l, struct sem_rec *e) {
     labelScope = 1;
-    struct sem_rec *ptr = l;
-    while (ptr->back.s_link)
-        ptr = ptr->back.s_link;
-    ptr->back.s_link = e;
-    return l;
+    return mergeList(l, e);
 }
 
 /*
@@ -393,16 +536,14 @@ struct sem_rec *exprs(struct sem_rec *l, struct sem_rec *e) {
  * Create the instructions for all of the formal and local types declared.
  */
 void fhead(struct id_entry *p) {
-    printf("func %s %d\n", p->i_name, p->i_type);
+    quad_func(p->i_name, p->i_type);
 
     int i;
     for (i = 0; i < formalnum; i++) {
         if (formaltypes[i] == 'i')
-            printf("formal %s %d %d\n", formalnames[i],
-                   (int) T_INT, tsize(T_INT));
+            quad_formal(formalnames[i], T_INT, tsize(T_INT));
         else
-            printf("formal %s %d %d\n", formalnames[i],
-                   (int) T_DOUBLE, tsize(T_DOUBLE));
+            quad_formal(formalnames[i], T_DOUBLE, tsize(T_DOUBLE));
     }
 
     for (i = 0; i < localnum; i++) {
@@ -412,15 +553,31 @@ void fhead(struct id_entry *p) {
             type |= T_ARRAY;
 
         if (localtypes[i] == 'i')
-            printf("localloc %s %d %d\n", localnames[i],
-                   (int) type, localwidths[i] * tsize(T_INT));
+            quad_localloc(localnames[i], type,
+                          localwidths[i] * tsize(T_INT), localwidths[i]);
         else
-            printf("localloc %s %d %d\n", localnames[i],
-                   (int) type, localwidths[i] * tsize(T_DOUBLE));
+            quad_localloc(localnames[i], type,
+                          localwidths[i] * tsize(T_DOUBLE), localwidths[i]);
     }
 
 }
 
+/*
+ * vardcl - variable declaration
+ * Locals go through dcl. A global outside any function is allocated in the
+ * quad buffer, so it reaches the consumer ahead of the next function.
+ */
+struct id_entry *vardcl(struct id_entry *p, int type) {
+    if (inFunction)
+        return dcl(p, type, 0);
+
+    p->i_type |= type;
+    p->i_scope = GLOBAL;
+    p->i_defined = 1;
+    quad_global(p->i_name, p->i_type, p->i_width * tsize(type & ~T_ARRAY), p->i_width);
+    return p;
+}
+
 /*
  * fname - function declaration
  * Enter block for new function scope.
@@ -430,6 +587,7 @@ void fhead(struct id_entry *p) {
 struct id_entry *fname(int t, char *id) {
     enterblock();
     currentFunctionType = t;
+    inFunction = 1;
 
     struct id_entry *idEntry;
     if ((idEntry = lookup(id, 0)) == NULL) {
@@ -448,48 +606,55 @@ struct id_entry *fname(int t, char *id) {
 
 /*
  * ftail - end of function body
- * Reset localnum and formalnum for array access. Then check unpatched labels
- * and clear the array so that
+ * Check unpatched labels and clear the array, then hand the function's quads
+ * on and reset localnum and formalnum for array access.
  */
 void ftail() {
-    printf("fend\n");
+    // go through bpArr and check for undefined labels; quad_kept still means this function
+    checkUnpatchedLabels();
+    clearLabelArray();
+
+    quad_fend(ntmp, labelNum, blankLabel);
+    quad_flush();
     leaveblock();
+    inFunction = 0;
     localnum = 0;
     formalnum = 0;
 
-    // go through bpArr and check for undefined labels
-    checkUnpatchedLabels();
-    clearLabelArray();
+    // no node, list or constant outlives its function, so drop them all
+    hintGeneration++;
+    hintCount = 0;
+    constGeneration++;
+    constCount = 0;
+    arenaChunk = NULL;
+    arenaUsed = 0;
+
+    // a forked front end numbers each function on its own; quad_deliver moves it into place
+    if (numberEachFunction) {
+        ntmp = 0;
+        labelNum = 0;
+        blankLabel = 0;
+    }
 }
 
 /*
  * Go through the backpatch labels and check if any were created without being declared.
- * If so, print an error.
+ * If so, print an error, unless another run of parseJobs keeps this function.
  */
 void checkUnpatchedLabels() {
     int i;
-    for (i = 0; i < MAXLABELS; i++) {
-        if (bpArr[i].patched == -1)
-            fprintf(stderr, "label %s referenced in goto, but never declared\n", bpArr[i].labelName);
+    for (i = 0; quad_kept() && i < currBpArr; i++) {
+        if (bpArr[i]->patched == -1)
+            fprintf(stderr, "label %s referenced in goto, but never declared\n", bpArr[i]->labelName);
     }
 }
 
 /*
- * When done with the function, clear out the label array. Reset everything to 0.
+ * When done with the function, retire its labels. Moving to the next generation
+ * makes every entry stale at once, so nothing is cleared.
  */
 void clearLabelArray() {
-    int i;
-    for (i = 0; i < MAXLABELS; i++) {
-        bpArr[i].patched = 0;
-        bpArr[i].topLabel = 0;
-
-        int j;
-        for (j = 0; j < MAXBLANKS; j++)
-            bpArr[i].labels[j] = 0;
-
-        strcpy(bpArr[i].labelName, "");
-    }
-
+    labelGeneration++;
     currBpArr = 0;
 }
 
@@ -509,25 +674,11 @@ struct sem_rec *id(char *x) {
         idEntry->i_defined = 1;
     }
 
-    int offset = idEntry->i_offset;
-    char scope[7];
-
-    if (idEntry->i_scope == LOCAL)
-        strcpy(scope, "local");
-    else if (idEntry->i_scope == PARAM)
-        strcpy(scope, "param");
-    else
-        strcpy(scope, "global");
-
-
     int temp = nexttemp();
-    if (idEntry->i_scope != GLOBAL)
-        printf("t%d := %s %s %d\n", temp, scope, idEntry->i_name, offset);
-    else
-        printf("t%d := %s %s\n", temp, scope, idEntry->i_name);
+    quad_ref(temp, idEntry->i_scope, idEntry->i_name, idEntry->i_offset);
 
     labelScope = 1;
-    return node(temp, idEntry->i_type | T_ADDR, NULL, NULL);
+    return newNode(temp, idEntry->i_type | T_ADDR, NULL, NULL);
 }
 
 /*
@@ -539,18 +690,19 @@ struct sem_rec *sindex(struct sem_rec *x, struct sem_rec *i) {
 
     if (i->s_mode == T_DOUBLE)
         cast(i, T_INT);
+    useTemp(i);
 
     char type = x->s_mode == T_INT ? 'i' : 'f';
     int temp = nexttemp();
-    printf("t%d := t%d []%c t%d\n", temp, x->s_place, type, i->s_place);
+    quad_index(temp, x->s_place, type, i->s_place);
 
     labelScope = 1;
-    return node(temp, x->s_mode, NULL, NULL);
+    return newNode(temp, x->s_mode, NULL, NULL);
 }
 
 /*
  * dogoto - goto statement
- * Checks if label has been installed. If it has, print out its label when goto.
+ * Checks if label has been installed. If it has, branch to its label when goto.
  * If not, 1) either create a temporary DS for it or 2) add to temp's list for later BP.
  */
 void dogoto(char *id) {
@@ -563,36 +715,77 @@ void dogoto(char *id) {
         // if not, add to the array
         int label = nextBlankLabel();
         labelScope = 1;
-        printf("br B%d\n", label);
+        quad_br(1, label);
         BackpatchLabel *list = findLabel(id);
         if (list == NULL) {
             addLabel(label, id);
         } else {
+            list->labels = quad_grow(list->labels, &list->maxLabels, list->topLabel + 1, sizeof(int));
             list->labels[list->topLabel++] = label;
         }
     } else {
-        printf("br L%d\n", idEntry->i_offset);
+        quad_br(0, idEntry->i_offset);
     }
 }
 
 /*
- * Create backpatch structure and add it to the array.
+ * Hash a label name into the bucket array.
+ */
+int labelBucket(char *id) {
+    unsigned h = 5381;
+    while (*id)
+        h = h * 33 + (unsigned char) *id++;
+    return (int) (h & (unsigned) (bpBuckets - 1));
+}
+
+/*
+ * Create backpatch structure and add it to the hash and this function's list.
+ * A stale entry in the same bucket is taken over before a new one is made;
+ * the table doubles when it holds twice as many entries as buckets.
  */
 void addLabel(int labelNo, char *id) {
-    if (currBpArr >= MAXLABELS) {
-        fprintf(stderr, "exceeded max limit of labels\n");
-        return;
+    BackpatchLabel *bpLabel = NULL;
+    int i;
+
+    if (bpBuckets == 0 || bpEntries >= 2 * bpBuckets) {
+        int oldBuckets = bpBuckets;
+        BackpatchLabel **oldHash = bpHash;
+
+        bpBuckets = bpBuckets ? 2 * bpBuckets : LABELBUCKETS;
+        bpHash = calloc(bpBuckets, sizeof(BackpatchLabel *));
+        for (i = 0; i < oldBuckets; i++) {
+            while (oldHash[i]) {
+                BackpatchLabel *p = oldHash[i];
+                int b = labelBucket(p->labelName);
+                oldHash[i] = p->next;
+                p->next = bpHash[b];
+                bpHash[b] = p;
+            }
+        }
+        free(oldHash);
     }
 
-    BackpatchLabel bpLabel;
-    int i;
-    for (i = 0; i < MAXBLANKS; i++) {
-        bpLabel.labels[i] = 0;
+    int b = labelBucket(id);
+    for (bpLabel = bpHash[b]; bpLabel; bpLabel = bpLabel->next) {
+        if (bpLabel->generation != labelGeneration)
+            break;
     }
-    bpLabel.topLabel = 0;
-    strcpy(bpLabel.labelName, id);
-    bpLabel.labels[bpLabel.topLabel++] = labelNo;
-    bpLabel.patched = -1;
+    if (bpLabel == NULL) {
+        bpLabel = calloc(1, sizeof(BackpatchLabel));
+        bpLabel->next = bpHash[b];
+        bpHash[b] = bpLabel;
+        bpEntries++;
+    }
+
+    free(bpLabel->labelName);
+    bpLabel->labelName = strdup(id);
+    bpLabel->topLabel = 0;
+    bpLabel->labels = quad_grow(bpLabel->labels, &bpLabel->maxLabels, 1, sizeof(int));
+    bpLabel->labels[bpLabel->topLabel++] = labelNo;
+    bpLabel->patched = -1;
+    bpLabel->generation = labelGeneration;
+
+    bpArr = quad_grow(bpArr, &maxBpArr, currBpArr + 1, sizeof(BackpatchLabel *));
     bpArr[currBpArr++] = bpLabel;
 }
 
@@ -620,7 +813,7 @@ void labeldcl(char *id) {
 
         if (list != NULL) {
             backpatchGotoLabels(list, label);
-            setBackpatchedLabel(id);
+            list->patched = 1;
         }
     } else {
         yyerror(" identifier error previously declared");
@@ -631,32 +824,23 @@ void labeldcl(char *id) {
 /*
  * BackpatchLabel Helpers
  * backpatchGotoLabels: backpatches the labels in the structure's array
- * setBackpatchedLabel: sets the flag for a backpatch structure, so it doesn't BP again
- * findLabel: find the structure in the array if it has been initialized
+ * findLabel: find the structure in the hash if this function has made it
  */
 void backpatchGotoLabels(BackpatchLabel *list, int label) {
     int i;
     for (i = 0; i < list->topLabel; i++) {
-        printf("B%d=L%d\n", list->labels[i], label);
-    }
-}
-
-void setBackpatchedLabel(char *id) {
-    int i;
-    for (i = 0; i < MAXLABELS; i++) {
-        if (strcmp(id, bpArr[i].labelName) == 0) {
-            bpArr[i].patched = 1;
-            return;
-        }
+        quad_patch(list->labels[i], label);
     }
 }
 
 BackpatchLabel *findLabel(char *id) {
-    int i;
-    for (i = 0; i < MAXLABELS; i++) {
-        if (strcmp(id, bpArr[i].labelName) == 0) {
-            return &bpArr[i];
-        }
+    BackpatchLabel *p;
+    if (bpBuckets == 0)
+        return NULL;
+
+    for (p = bpHash[labelBucket(id)]; p; p = p->next) {
+        if (p->generation == labelGeneration && strcmp(id, p->labelName) == 0)
+            return p;
     }
 
     return NULL;
@@ -670,7 +854,7 @@ BackpatchLabel *findLabel(char *id) {
  */
 int m() {
     if (labelScope == 1) {
-        printf("label L%d\n", ++labelNum);
+        quad_label(++labelNum);
         labelScope = 0;
     }
     return labelNum;
@@ -682,47 +866,62 @@ int m() {
 struct sem_rec *n() {
     int label = nextBlankLabel();
     labelScope = 1;
-    printf("br B%d\n", label);
-    return node(label, 0, NULL, NULL);
+    quad_br(1, label);
+    return newNode(label, 0, NULL, NULL);
 }
 
 /*
  * op1 - unary operators
  * Reference, bitwise complement, and negate y-rec. If y is a DOUBLE, then it should
- * be cast to an int before using bitwise complement. Otherwise, print off their
- * respective instructions.
+ * be cast to an int before using bitwise complement. Otherwise, emit their
+ * respective instructions. Negating or complementing a constant folds.
  */
 struct sem_rec *op1(char *op, struct sem_rec *y) {
+    ConstTemp *c;
     labelScope = 1;
+    if ((*op == '-' || *op == '~') && (c = findConst(y)) != NULL) {
+        if (*op == '~' && c->mode == T_DOUBLE)
+            c = findConst(cast(y, T_INT));
+        struct sem_rec *folded = NULL;
+        if (c != NULL && c->mode == T_INT)
+            folded = constant(T_INT, *op == '-' ? (int) (0u - (unsigned) c->ival) : ~c->ival, 0);
+        else if (c != NULL)
+            folded = constant(T_DOUBLE, 0, -c->fval);
+        if (folded)
+            return folded;
+    }
+
     if (*op == '@' && !(y->s_mode & T_ARRAY)) {
         y->s_mode &= ~T_ADDR;
         int temp = nexttemp();
         char type = y->s_mode & T_INT ? 'i' : 'f';
-        printf("t%d := @%c t%d\n", temp, type, y->s_place);
-        return node(temp, y->s_mode, NULL, NULL);
+        quad_unary(temp, "@", type, y->s_place);
+        return newNode(temp, y->s_mode, NULL, NULL);
     } else if (*op == '-') {
         y->s_mode &= ~T_ADDR;
+        useTemp(y);
         int temp = nexttemp();
         char type = y->s_mode & T_INT ? 'i' : 'f';
-        printf("t%d := -%c t%d\n", temp, type, y->s_place);
-        return node(temp, y->s_mode, NULL, NULL);
+        quad_unary(temp, "-", type, y->s_place);
+        return newNode(temp, y->s_mode, NULL, NULL);
     } else if (*op == '~') {
         y->s_mode &= ~T_ADDR;
         if (y->s_mode == T_DOUBLE)
             y = cast(y, T_INT);
+        useTemp(y);
         int temp = nexttemp();
         char type = y->s_mode & T_INT ? 'i' : 'f';
-        printf("t%d := ~%c t%d\n", temp, type, y->s_place);
-        return node(temp, y->s_mode, NULL, NULL);
+        quad_unary(temp, "~", type, y->s_place);
+        return newNode(temp, y->s_mode, NULL, NULL);
     }
 
-    return node(y->s_place, y->s_mode, NULL, NULL);
+    return newNode(y->s_place, y->s_mode, NULL, NULL);
 }
 
 /*
  * op2 - arithmetic operators
- * If any operator is T_DOUBLE, convert the other operator that isn't. Then print of the quadruple
- * depending on the switch cases.
+ * If any operator is T_DOUBLE, convert the other operator that isn't. Fold two constants,
+ * otherwise emit the quadruple depending on the switch cases.
  */
 struct sem_rec *op2(char *op, struct sem_rec *x, struct sem_rec *y) {
     char type;
@@ -738,24 +937,30 @@ struct sem_rec *op2(char *op, struct sem_rec *x, struct sem_rec *y) {
         type = x->s_mode == T_DOUBLE ? 'f' : 'i';
     }
 
+    struct sem_rec *folded = foldBinary(op, x, y);
+    if (folded)
+        return folded;
+    useTemp(x);
+    useTemp(y);
+
     int temp = nexttemp();
     switch (*op) {
         case '+':
-            printf("t%d := t%d +%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "+", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '-':
-            printf("t%d := t%d -%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "-", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '*':
-            printf("t%d := t%d *%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "*", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '/':
-            printf("t%d := t%d /%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "/", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '%':
             if (x->s_mode == T_DOUBLE || y->s_mode == T_DOUBLE) yyerror(" cannot %% floating-point values");
-            printf("t%d := t%d %c%c t%d\n", temp, x->s_place, '%', type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "%", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         default:
             fprintf(stderr, "sem: op2 not implemented\n");
             return ((struct sem_rec *) NULL);
@@ -765,7 +970,7 @@ struct sem_rec *op2(char *op, struct sem_rec *x, struct sem_rec *y) {
 /*
  * opb - bitwise operators
  * If any of the operators are double, they should be converted to T_INT if working with bit operators.
- * Then, select which operator based on the string comparison in switch.
+ * Fold two constants; otherwise select which operator based on the string comparison in switch.
  */
 struct sem_rec *opb(char *op, struct sem_rec *x, struct sem_rec *y) {
     char type = 'i';
@@ -777,23 +982,29 @@ struct sem_rec *opb(char *op, struct sem_rec *x, struct sem_rec *y) {
     if (x->s_mode == T_DOUBLE)
         x = cast(x, T_INT);
 
+    struct sem_rec *folded = foldBinary(op, x, y);
+    if (folded)
+        return folded;
+    useTemp(x);
+    useTemp(y);
+
     int temp = nexttemp();
     switch (*op) {
         case '|':
-            printf("t%d := t%d |%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "|", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '^':
-            printf("t%d := t%d ^%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "^", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '&':
-            printf("t%d := t%d &%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "&", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '<':
-            printf("t%d := t%d <<%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, "<<", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         case '>':
-            printf("t%d := t%d >>%c t%d\n", temp, x->s_place, type, y->s_place);
-            return node(temp, x->s_mode, NULL, NULL);
+            quad_binop(temp, x->s_place, ">>", type, y->s_place);
+            return newNode(temp, x->s_mode, NULL, NULL);
         default:
             fprintf(stderr, "sem: opb not implemented\n");
             return ((struct sem_rec *) NULL);
@@ -803,7 +1014,9 @@ struct sem_rec *opb(char *op, struct sem_rec *x, struct sem_rec *y) {
 /*
  * rel - relational operators
  * Do a cast if any of the variables in a relation are double onto the other variable.
- * Then print out the quadruple after comparing the operation strings.
+ * Then emit the quadruple after comparing the operation strings. A relation of two
+ * constants is decided here: one unconditional branch goes on the list it picks,
+ * and the other list stays empty.
  */
 struct sem_rec *rel(char *op, struct sem_rec *x, struct sem_rec *y) {
     char type;
@@ -817,27 +1030,39 @@ struct sem_rec *rel(char *op, struct sem_rec *x, struct sem_rec *y) {
         type = x->s_mode == T_DOUBLE ? 'f' : 'i';
     }
 
+    int truth = foldRelation(op, x, y);
+    if (truth != -1) {
+        int label = nextBlankLabel();
+        quad_br(1, label);
+        labelScope = 1;
+        if (truth)
+            return newNode(0, 0, newNode(label, 0, NULL, NULL), NULL);
+        return newNode(0, 0, NULL, newNode(label, 0, NULL, NULL));
+    }
+    useTemp(x);
+    useTemp(y);
+
     int temp = nexttemp();
 
     if (strcmp(op, "==") == 0) {
-        printf("t%d := t%d ==%c t%d\n", temp, x->s_place, type, y->s_place);
+        quad_binop(temp, x->s_place, "==", type, y->s_place);
     } else if (strcmp(op, "!=") == 0) {
-        printf("t%d := t%d !=%c t%d\n", temp, x->s_place, type, y->s_place);
+        quad_binop(temp, x->s_place, "!=", type, y->s_place);
     } else if (strcmp(op, "<=") == 0) {
-        printf("t%d := t%d <=%c t%d\n", temp, x->s_place, type, y->s_place);
+        quad_binop(temp, x->s_place, "<=", type, y->s_place);
     } else if (strcmp(op, ">=") == 0) {
-        printf("t%d := t%d >=%c t%d\n", temp, x->s_place, type, y->s_place);
+        quad_binop(temp, x->s_place, ">=", type, y->s_place);
     } else if (strcmp(op, "<") == 0) {
-        printf("t%d := t%d <%c t%d\n", temp, x->s_place, type, y->s_place);
+        quad_binop(temp, x->s_place, "<", type, y->s_place);
     } else { // ">"
-        printf("t%d := t%d >%c t%d\n", temp, x->s_place, type, y->s_place);
+        quad_binop(temp, x->s_place, ">", type, y->s_place);
     }
 
     int trueLabel = nextBlankLabel(), falseLabel = nextBlankLabel();
-    printf("bt t%d B%d\n", temp, trueLabel);
-    printf("br B%d\n", falseLabel);
+    quad_bt(temp, trueLabel);
+    quad_br(1, falseLabel);
 
-    struct sem_rec *returnValue = node(temp, x->s_mode, node(0, 0, NULL, NULL), node(0, 0, NULL, NULL));
+    struct sem_rec *returnValue = newNode(temp, x->s_mode, newNode(0, 0, NULL, NULL), newNode(0, 0, NULL, NULL));
     returnValue->back.s_true->s_place = trueLabel;
     returnValue->s_false->s_place = falseLabel;
 
@@ -881,6 +1106,7 @@ struct sem_rec *set(char *op, struct sem_rec *x, struct sem_rec *y) {
         cast(y, T_DOUBLE);
     else if ((x->s_mode & T_ARRAY) == T_ARRAY && y->s_mode == T_DOUBLE)
         cast(y, x->s_mode & ~T_ARRAY);
+    useTemp(y);
 
     int temp = nexttemp();
     char type;
@@ -888,9 +1114,9 @@ struct sem_rec *set(char *op, struct sem_rec *x, struct sem_rec *y) {
         type = 'f';
     else
         type = 'i';
-    printf("t%d := t%d =%c t%d\n", temp, x->s_place, type, y->s_place);
+    quad_store(temp, x->s_place, type, y->s_place);
     labelScope = 1;
-    return node(temp, x->s_mode, NULL, NULL);
+    return newNode(temp, x->s_mode, NULL, NULL);
 }
 
 
@@ -904,8 +1130,8 @@ void startloopscope() {
     enterblock();
 
     // create new continue list sem_rec
-    stackPush(&continueStack, node(0, 0, NULL, NULL));
-    stackPush(&breakStack, node(0, 0, NULL, NULL));
+    stackPush(&continueStack, newNode(0, 0, NULL, NULL));
+    stackPush(&breakStack, newNode(0, 0, NULL, NULL));
 }
 
 /*
@@ -922,45 +1148,195 @@ struct sem_rec *string(char *s) {
     }
 
     int temp = nexttemp();
-    printf("t%d := %s\n", temp, s);
+    quad_str(temp, s);
     labelScope = 1;
-    return node(temp, idEntry->i_type, NULL, NULL);
+    return newNode(temp, idEntry->i_type, NULL, NULL);
 }
 
 /*
  * Convert passed in rec to the cast type.
- * Update the t-variable and return with t-type.
+ * Update the t-variable and return with t-type. A constant is converted
+ * here when the result is still a constant con() can print.
  */
 struct sem_rec *cast(struct sem_rec *x, int t) {
+    ConstTemp *c = findConst(x);
+    if (c != NULL && (t == T_DOUBLE ? c->mode == T_INT :
+                      c->mode == T_DOUBLE && c->fval > INT_MIN - 1.0 && c->fval < INT_MAX + 1.0)) {
+        struct sem_rec *folded = t == T_DOUBLE ? constant(T_DOUBLE, 0, c->ival) :
+                                 constant(T_INT, (int) c->fval, 0);
+        x->s_place = folded->s_place;
+        x->s_mode = t;
+        return x;
+    }
+
+    useTemp(x);
     int temp = nexttemp();
     char type = t == T_INT ? 'i' : 'f';
-    printf("t%d := cv%c t%d\n", temp, type, x->s_place);
+    quad_cv(temp, type, x->s_place);
     x->s_place = temp;
     x->s_mode = t;
 
     return x;
 }
 
+/*
+ * Constant Helpers
+ * constSlot: the table slot of a temp, or the empty slot to put it in
+ * findConst: the constant a record holds, if it is one
+ * constant: a new constant temp; doubles that are not whole ints are left
+ *           to run time, so the caller gets NULL for those
+ * useTemp: emit the quads of a constant about to be used at run time
+ */
+ConstTemp *constSlot(int place) {
+    if (constCount * 2 >= constSlots) {
+        ConstTemp *oldConsts = constTemps;
+        int oldSlots = constSlots, i;
+
+        constSlots = constSlots ? 2 * constSlots : CONSTSLOTS;
+        constTemps = calloc(constSlots, sizeof(ConstTemp));
+        constCount = 0;
+        for (i = 0; i < oldSlots; i++) {
+            if (oldConsts[i].generation == constGeneration) {
+                *constSlot(oldConsts[i].place) = oldConsts[i];
+                constCount++;
+            }
+        }
+        free(oldConsts);
+    }
+
+    int slot = (int) (((unsigned) place * 2654435761U) & (unsigned) (constSlots - 1));
+    while (constTemps[slot].generation == constGeneration && constTemps[slot].place != place)
+        slot = (slot + 1) & (constSlots - 1);
+    return &constTemps[slot];
+}
+
+ConstTemp *findConst(struct sem_rec *x) {
+    if (x == NULL || constSlots == 0)
+        return NULL;
+
+    ConstTemp *c = constSlot(x->s_place);
+    if (c->generation != constGeneration || c->mode != x->s_mode)
+        return NULL;
+    return c;
+}
+
+struct sem_rec *constant(int mode, int ival, double fval) {
+    if (mode == T_DOUBLE && (fval < INT_MIN || fval > INT_MAX || fval != (int) fval ||
+                             (fval == 0 && signbit(fval))))
+        return NULL;
+
+    int temp = nexttemp();
+    ConstTemp *c = constSlot(temp);
+    c->place = temp;
+    c->mode = mode;
+    c->ival = mode == T_DOUBLE ? (int) fval : ival;
+    c->fval = mode == T_DOUBLE ? fval : ival;
+    c->emitted = 0;
+    c->generation = constGeneration;
+    constCount++;
+    return newNode(temp, mode, NULL, NULL);
+}
+
+void useTemp(struct sem_rec *x) {
+    ConstTemp *c = findConst(x);
+    char text[16];
+
+    if (c == NULL || c->emitted)
+        return;
+    c->emitted = 1;
+    sprintf(text, "%d", c->ival);
+    if (c->mode == T_INT) {
+        quad_con(c->place, text);
+    } else {
+        int temp = nexttemp();
+        quad_con(temp, text);
+        quad_cv(c->place, 'f', temp);
+    }
+}
+
+/*
+ * Fold an arithmetic or bitwise operator over two constants of one mode.
+ * Ints wrap like the machine's; division by zero, INT_MIN / -1 and shifts
+ * outside the word are left for run time, as is any other op returning NULL.
+ */
+struct sem_rec *foldBinary(char *op, struct sem_rec *x, struct sem_rec *y) {
+    ConstTemp *cx = findConst(x), *cy = findConst(y);
+    if (cx == NULL || cy == NULL || cx->mode != cy->mode)
+        return NULL;
+
+    if (cx->mode == T_DOUBLE) {
+        double a = cx->fval, b = cy->fval;
+        switch (*op) {
+            case '+': return constant(T_DOUBLE, 0, a + b);
+            case '-': return constant(T_DOUBLE, 0, a - b);
+            case '*': return constant(T_DOUBLE, 0, a * b);
+            case '/': return b != 0 ? constant(T_DOUBLE, 0, a / b) : NULL;
+            default: return NULL;
+        }
+    }
+
+    int a = cx->ival, b = cy->ival;
+    unsigned ua = (unsigned) a, ub = (unsigned) b;
+    switch (*op) {
+        case '+': return constant(T_INT, (int) (ua + ub), 0);
+        case '-': return constant(T_INT, (int) (ua - ub), 0);
+        case '*': return constant(T_INT, (int) (ua * ub), 0);
+        case '/':
+        case '%':
+            if (b == 0 || (a == INT_MIN && b == -1))
+                return NULL;
+            return constant(T_INT, *op == '/' ? a / b : a % b, 0);
+        case '|': return constant(T_INT, a | b, 0);
+        case '^': return constant(T_INT, a ^ b, 0);
+        case '&': return constant(T_INT, a & b, 0);
+        case '<': return b >= 0 && b < 32 ? constant(T_INT, (int) (ua << b), 0) : NULL;
+        case '>': return b >= 0 && b < 32 ? constant(T_INT, a >> b, 0) : NULL;
+        default: return NULL;
+    }
+}
+
+/*
+ * Decide a relation between two constants: 1 or 0, or -1 when either
+ * side is only known at run time.
+ */
+int foldRelation(char *op, struct sem_rec *x, struct sem_rec *y) {
+    ConstTemp *cx = findConst(x), *cy = findConst(y);
+    if (cx == NULL || cy == NULL || cx->mode != cy->mode)
+        return -1;
+
+    double a = cx->mode == T_DOUBLE ? cx->fval : cx->ival;
+    double b = cy->mode == T_DOUBLE ? cy->fval : cy->ival;
+    if (strcmp(op, "==") == 0)
+        return a == b;
+    else if (strcmp(op, "!=") == 0)
+        return a != b;
+    else if (strcmp(op, "<=") == 0)
+        return a <= b;
+    else if (strcmp(op, ">=") == 0)
+        return a >= b;
+    else if (strcmp(op, "<") == 0)
+        return a < b;
+    return a > b;
+}
+
 /* Stack Helper Functions */
 /*
  * stackTop: retrieve top of stack
- * stackPush: add item to stack
+ * stackPush: add item to stack, growing it as needed
  * stackPop: remove from top of stack
  */
 struct sem_rec *stackTop(Stack *stack) {
     if (stack->size == 0) {
         fprintf(stderr, "Error: stack empty\n");
-        return node(0, 0, NULL, NULL);
+        return newNode(0, 0, NULL, NULL);
     }
 
     return stack->data[stack->size - 1];
 }
 
 void stackPush(Stack *stack, struct sem_rec *rec) {
-    if (stack->size < MAXRECS)
-        stack->data[stack->size++] = rec;
-    else
-        fprintf(stderr, "Error: stack full\n");
+    stack->data = quad_grow(stack->data, &stack->max, stack->size + 1, sizeof(struct sem_rec *));
+    stack->data[stack->size++] = rec;
 }
 
 void stackPop(Stack *stack) {
@@ -970,3 +1346,35 @@ void stackPop(Stack *stack) {
         stack->size--;
 }
 
+/*
+ * newNode - allocate a semantic record from the arena, like node in semutil.c
+ */
+struct sem_rec *newNode(int place, int mode, struct sem_rec *p1, struct sem_rec *p2) {
+    struct sem_rec *rec;
+
+    if (arenaChunk == NULL || arenaUsed == ARENACHUNK) {
+        ArenaChunk *next = arenaChunk ? arenaChunk->next : arenaHead;
+        if (next == NULL) {
+            if ((next = malloc(sizeof(ArenaChunk))) == NULL) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+            next->next = NULL;
+            if (arenaChunk)
+                arenaChunk->next = next;
+            else
+                arenaHead = next;
+        }
+        arenaChunk = next;
+        arenaUsed = 0;
+    }
+
+    rec = &arenaChunk->nodes[arenaUsed++];
+    memset(rec, 0, sizeof(*rec));
+    rec->s_place = place;
+    rec->s_mode = mode;
+    rec->back.s_link = p1;
+    rec->s_false = p2;
+    return rec;
+}
+
@@ -0,0 +1,213 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <stddef.h>
+# include "cc.h"
+# include "sym.h"
+# include "quadbuf.h"
+
+#define NAMESLOTS 1024
+#define POOLCHUNK 65536
+
+/*
+ * Symbol table. Every name is interned once into a name record, which keeps
+ * its hash and the innermost entry declared under it; entries for the same
+ * name are chained through i_link, newest first, and i_name is the record's
+ * own text. So a lookup is one probe of the name table, and an entry can get
+ * back to its record without hashing again.
+ */
+struct sym_name {
+    struct id_entry *top;           /* innermost entry, NULL when none is visible */
+    unsigned hash;
+    char text[];
+} typedef SymName;
+
+/*
+ * Entries installed at each block level, in order. Leaving a block unlinks
+ * the entries logged at its level and deeper, so nothing else is rescanned.
+ */
+struct sym_scope {
+    struct id_entry **entries;
+    int size;
+    int max;
+} typedef SymScope;
+
+int level = 0;
+
+static SymName **names = NULL;
+static int nameSlots = 0;
+static int nameCount = 0;
+
+static SymScope *scopes = NULL;
+static int maxScopes = 0;
+static int deepest = -1;            /* highest level with logged entries */
+
+static char *pool = NULL;
+static size_t poolLeft = 0;
+
+static SymName *intern(char *s, size_t len);
+static SymName *nameOf(struct id_entry *p);
+static void *poolAlloc(size_t size);
+
+/*
+ * install - install name with block level blev (the current level when
+ * blev < 0), return ptr
+ */
+struct id_entry *install(char *s, int blev) {
+    SymName *name = intern(s, strlen(s));
+    struct id_entry *p = poolAlloc(sizeof(struct id_entry));
+    SymScope *scope;
+
+    if (blev < 0)
+        blev = level;
+    p->i_name = name->text;
+    p->i_blevel = blev;
+    p->i_link = name->top;
+    name->top = p;
+
+    if (blev >= maxScopes) {
+        int old = maxScopes;
+        scopes = quad_grow(scopes, &maxScopes, blev + 1, sizeof(SymScope));
+        memset(scopes + old, 0, (maxScopes - old) * sizeof(SymScope));
+    }
+    scope = &scopes[blev];
+    scope->entries = quad_grow(scope->entries, &scope->max, scope->size + 1, sizeof(struct id_entry *));
+    scope->entries[scope->size++] = p;
+    if (blev > deepest)
+        deepest = blev;
+    return p;
+}
+
+/*
+ * lookup - innermost entry for name, or with blev nonzero the entry at
+ * that block level; NULL if there is none
+ */
+struct id_entry *lookup(char *s, int blev) {
+    struct id_entry *p = intern(s, strlen(s))->top;
+
+    while (blev != 0 && p != NULL && p->i_blevel != blev)
+        p = p->i_link;
+    return p;
+}
+
+/*
+ * slookup - the interned copy of s, which lives as long as the table
+ */
+char *slookup(char *s) {
+    return intern(s, strlen(s))->text;
+}
+
+/*
+ * slookupn - slookup of the len characters at s, which need not end there
+ */
+char *slookupn(char *s, int len) {
+    return intern(s, len)->text;
+}
+
+/*
+ * enterblock - enter a new block level
+ */
+void enterblock() {
+    level++;
+}
+
+/*
+ * leaveblock - drop the entries of the current level and deeper, newest
+ * first, and go back to the enclosing level
+ */
+void leaveblock() {
+    int i;
+
+    for (; deepest >= level && deepest >= 0; deepest--) {
+        SymScope *scope = &scopes[deepest];
+        for (i = scope->size - 1; i >= 0; i--) {
+            struct id_entry *p = scope->entries[i];
+            struct id_entry **link = &nameOf(p)->top;
+            while (*link != p)
+                link = &(*link)->i_link;
+            *link = p->i_link;
+        }
+        scope->size = 0;
+    }
+    if (level > 0)
+        level--;
+}
+
+/*
+ * intern - find or add the record for the len characters at s; the table
+ * is open addressed and kept at most half full
+ */
+static SymName *intern(char *s, size_t len) {
+    unsigned hash = 2166136261u;
+    SymName *name;
+    size_t k;
+    int i;
+
+    for (k = 0; k < len; k++)
+        hash = (hash ^ (unsigned char) s[k]) * 16777619u;
+
+    if (names != NULL) {
+        for (i = hash & (nameSlots - 1); (name = names[i]) != NULL; i = (i + 1) & (nameSlots - 1))
+            if (name->hash == hash && memcmp(name->text, s, len) == 0 && name->text[len] == '\0')
+                return name;
+    }
+
+    if (2 * (nameCount + 1) > nameSlots) {
+        SymName **oldNames = names;
+        int oldSlots = nameSlots;
+
+        nameSlots = nameSlots ? nameSlots * 2 : NAMESLOTS;
+        if ((names = calloc(nameSlots, sizeof(SymName *))) == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        for (i = 0; i < oldSlots; i++) {
+            int j;
+            if (oldNames[i] == NULL)
+                continue;
+            for (j = oldNames[i]->hash & (nameSlots - 1); names[j] != NULL; j = (j + 1) & (nameSlots - 1))
+                ;
+            names[j] = oldNames[i];
+        }
+        free(oldNames);
+    }
+
+    name = poolAlloc(offsetof(SymName, text) + len + 1);
+    name->top = NULL;
+    name->hash = hash;
+    memcpy(name->text, s, len);
+    name->text[len] = '\0';
+    for (i = hash & (nameSlots - 1); names[i] != NULL; i = (i + 1) & (nameSlots - 1))
+        ;
+    names[i] = name;
+    nameCount++;
+    return name;
+}
+
+/*
+ * nameOf - the record an entry's name was interned in
+ */
+static SymName *nameOf(struct id_entry *p) {
+    return (SymName *) (p->i_name - offsetof(SymName, text));
+}
+
+/*
+ * poolAlloc - zeroed, pointer aligned memory that is never given back
+ */
+static void *poolAlloc(size_t size) {
+    void *p;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (size > poolLeft) {
+        size_t chunk = size > POOLCHUNK ? size : POOLCHUNK;
+        if ((pool = calloc(1, chunk)) == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        poolLeft = chunk;
+    }
+    p = pool;
+    pool += size;
+    poolLeft -= size;
+    return p;
+}